@@ -0,0 +1,46 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef C_BOARD_H_INCLUDED
+#define C_BOARD_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/*
+ The board advertise its optional features in the information string ($I command)
+ with whitespace or ';' separated "KEY=VALUE" tokens, values are ',' separated lists.
+
+ ex: "MM1_Writer rev3 ENC=DEC,HEX,BIN"
+*/
+
+bool GetBoardCapability(const std::string& information, const std::string& key, std::string& value);
+bool HasBoardCapabilityValue(const std::string& information, const std::string& key, const std::string& value);
+bool HasBoardCommand(const std::string& information, const std::string& command); //Optional commands "CMD=..."
+
+uint8_t GetBoardEncodings(const std::string& information);
+uint8_t GetBestEncoding(uint8_t encodings);
+
+uint8_t GetBoardChecksums(const std::string& information);
+uint8_t GetBestChecksum(uint8_t checksums);
+
+uint8_t GetBoardCompressions(const std::string& information); //"COMP=RLE,LZ", the plain data is always supported
+
+std::size_t GetBoardBaudrates(const std::string& information, std::vector<uint32_t>& baudrates); //sorted from the fastest
+bool HasBoardHardwareFlowControl(const std::string& information);
+
+#endif // C_BOARD_H_INCLUDED
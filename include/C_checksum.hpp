@@ -17,8 +17,37 @@
 #ifndef C_CHECKSUM_H_INCLUDED
 #define C_CHECKSUM_H_INCLUDED
 
+#include <string>
 #include <cstdint>
+#include <cstddef>
 
-uint8_t CalculateChecksum(uint8_t* data, uint8_t numOfData);
+#define CRC32_INIT 0xFFFFFFFF
+#define MAX_CHECKSUM_SIZE 4
+
+//Checksum of the write frames and of the read replies
+enum CHECKSUM_TYPE : uint8_t
+{
+    CHECKSUM_SUM8  = 0, //8bit additive sum (default, always supported)
+    CHECKSUM_CRC32 = 1, //CRC-32 (IEEE 802.3), sent most significant byte first
+
+    CHECKSUM_COUNT
+};
+
+uint8_t CalculateChecksum(const uint8_t* data, uint8_t numOfData);
+
+//CRC-32 (IEEE 802.3), table driven 8 bytes at a time
+uint32_t UpdateCrc32(uint32_t crc, const uint8_t* data, std::size_t size); //crc starts with CRC32_INIT
+uint32_t FinalizeCrc32(uint32_t crc);
+uint32_t CalculateCrc32(const uint8_t* data, std::size_t size);
+
+const char* GetChecksumName(uint8_t checksumType);
+bool GetChecksumFromName(const std::string& name, uint8_t& checksumType);
+
+uint8_t GetChecksumSize(uint8_t checksumType);
+//Write the checksum bytes of the data, return the number of bytes
+uint8_t GetChecksumBytes(const uint8_t* data, std::size_t numOfData, uint8_t checksumType, uint8_t* checksum);
+
+//64bit FNV-1a hash, used to detect changed sectors
+uint64_t CalculateHash(const uint8_t* data, std::size_t size);
 
 #endif // C_CHECKSUM_H_INCLUDED
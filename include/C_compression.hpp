@@ -0,0 +1,59 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef C_COMPRESSION_H_INCLUDED
+#define C_COMPRESSION_H_INCLUDED
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ Compression of the write frame data, the board expands it in its page buffer before programming.
+
+ Both formats are a list of tokens starting with a control byte c :
+    c < 0x80 : c+1 literal bytes follow
+    c >= 0x80 : RLE, the next byte is repeated (c&0x7F)+COMPRESSION_RLE_MIN times
+                LZ, copy (c&0x7F)+COMPRESSION_LZ_MIN bytes from a 2 bytes distance (most significant byte first)
+                    back in the expanded data, the copy can overlap itself
+ A match only refers to the data of the same frame, so the board doesn't need any history.
+*/
+
+#define COMPRESSION_MAX_LITERALS 128
+#define COMPRESSION_RLE_MIN 3
+#define COMPRESSION_LZ_MIN 4
+#define COMPRESSION_LZ_MAX_DISTANCE 0xFFFF
+#define COMPRESSION_LZ_HASH_BITS 12
+
+enum COMPRESSION : uint8_t
+{
+    COMP_NONE = 0, //Plain data (default, always supported)
+    COMP_RLE  = 1, //Runs of the same byte
+    COMP_LZ   = 2, //Copies of the previous data, runs included
+
+    COMP_COUNT
+};
+
+const char* GetCompressionName(uint8_t compression);
+bool GetCompressionFromName(const std::string& name, uint8_t& compression);
+
+std::size_t GetCompressedMaxSize(std::size_t numOfData);
+
+//The buffer must hold at least GetCompressedMaxSize() bytes, return the compressed size
+std::size_t CompressData(uint8_t compression, const uint8_t* data, std::size_t numOfData, uint8_t* buffer);
+//Expand exactly numOfData bytes, every compressed byte must be used
+bool DecompressData(uint8_t compression, const uint8_t* data, std::size_t size, uint8_t* buffer, std::size_t numOfData);
+
+#endif // C_COMPRESSION_H_INCLUDED
@@ -0,0 +1,74 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef C_DAEMON_H_INCLUDED
+#define C_DAEMON_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <atomic>
+#include <cstdint>
+
+#include "C_transfer.hpp"
+
+/*
+ Flashing daemon : the ports stay opened with the board handshake done (hello, information, baudrate,
+ encoding, checksum and memory model) and the transfers are given as jobs over a local Unix socket.
+
+ A job is a text header followed by the file data :
+    "codeGTransfer job 1\n"
+    one option per line, the transfer options and "--port=<name>", "--stats"
+    "DATA <size>\n" followed by size bytes, only the bytes of the segments when the "--segments=" option is given
+ The daemon answers with the transfer log, every line starting with "LOG ", and a last "RESULT <code>\n" line.
+
+ A dump job has the "--dump" and "--length=<n>" options and no data ("DATA 0\n"), the memory is sent back
+ before the result with a "DUMP <sector size> <size>\n" line followed by size bytes.
+
+ The jobs of a port are done in order, the ports work in parallel. Before a job the board is resynchronised,
+ the whole handshake is done again only when the board doesn't answer anymore.
+*/
+
+#define DAEMON_JOB_HEADER "codeGTransfer job 1"
+#define DAEMON_MAX_DATASIZE 0x1000000 //Bytes sent with a job, the holes of a segmented image are not sent
+#define DAEMON_RECEIVE_TIMEOUT 5000 //ms, deadline to receive a whole job (header and data), the other clients wait meanwhile
+#define DAEMON_SOCKET_MODE 0600 //Only the user of the daemon can send jobs
+#define DAEMON_POLL_INTERVAL 200 //ms, to check the running flag
+
+#ifndef _WIN32
+
+struct DaemonSettings
+{
+    std::string socketPath;
+    std::vector<std::string> portNames;
+    TransferSettings settings; //of the sessions (baudrate, flow control, encoding, checksum), default of the jobs
+};
+
+//Serve the jobs until running is false
+int RunDaemon(const DaemonSettings& settings, const std::atomic<bool>& running, std::ostream& log);
+
+//Memory sent back by the daemon for a dump job
+struct DaemonDump
+{
+    std::vector<uint8_t> data;
+    uint32_t sectorSize = 0;
+};
+
+//Send a job to the daemon and write its log, return the result of the job
+int SendDaemonJob(const std::string& socketPath, const std::vector<std::string>& options, const std::vector<uint8_t>& fileData, std::ostream& log, DaemonDump* dump = nullptr);
+
+#endif //_WIN32
+
+#endif // C_DAEMON_H_INCLUDED
@@ -0,0 +1,112 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef C_EMULATOR_H_INCLUDED
+#define C_EMULATOR_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <cstdint>
+
+#include "C_memory.hpp"
+
+/*
+ Emulation of the MM1 writer board, used to test and benchmark the transfer without the hardware.
+
+ The emulator implements the commands as the host expects them and emulate the time spent on the wire
+ (from the baudrate), the command processing and the memory write/erase times.
+*/
+
+struct EmulatorSettings
+{
+    std::string information = "MM1_Writer emulator ENC=DEC,HEX,BIN CHK=SUM,CRC32 BAUD=19200,57600,115200,230400,460800,921600 FLOW=RTSCTS CMD=BLANK,CRC COMP=RLE,LZ"
+                              " EEPROM=PAGE:64,PAYLOAD:1024,WRITE:10000 FLASH=PAGE:256,SECTOR:4096,PAYLOAD:1024,WRITE:5120,ERASE:25000";
+
+    uint32_t baudrate = 9600; //0 to disable the wire latency
+    uint32_t commandDelay = 100; //us, processing time of every command
+    uint32_t eepromWriteTime = 10000; //us, per started EEPROM page
+    uint32_t eepromPageSize = 64;
+    uint32_t flashWriteTime = 20; //us, per byte
+    uint32_t flashEraseTime = 25000; //us, per sector
+    uint32_t crcTime = 50; //ns, per byte of a range CRC
+
+    uint32_t flashSectorSize = DEFAULT_SECTOR_SIZE;
+    uint32_t maxPayload = 1024; //data bytes accepted per write frame
+
+    uint32_t dropInterval = 0; //Ignore one write or read command every n of them, 0 to never
+
+    uint32_t eepromSize = 0x10000;
+    uint32_t flashSize = 0x100000;
+};
+
+struct EmulatorStats
+{
+    std::map<std::string, std::vector<uint32_t> > latencies; //us, from the command sent by the host to its reply received
+    std::vector<uint32_t> turnarounds; //us, from a reply received by the host to its next command
+    uint64_t receivedBytes = 0;
+    uint64_t sentBytes = 0;
+    uint32_t commands = 0;
+};
+
+class Emulator
+{
+public:
+    explicit Emulator(const EmulatorSettings& settings);
+
+    //Execute a complete frame ('$' to '#'), return the reply (empty when dropped) and the time spent by the board in us
+    std::string execute(const std::string& frame, uint32_t& processingTime);
+
+    static std::string getCommandName(const std::string& frame);
+
+    const EmulatorSettings& getSettings() const;
+    uint32_t getBaudrate() const;
+    const std::vector<uint8_t>& getMemory(uint8_t memoryModel) const;
+
+private:
+    std::string executeWrite(const std::string& frame, bool sequenced, bool compressed, uint32_t& processingTime);
+    std::string executeRead(const std::string& frame);
+    std::string executeErase(const std::string& frame, uint32_t& processingTime);
+    std::string executeBlankCheck(const std::string& frame);
+    std::string executeRangeCrc(const std::string& frame, uint32_t& processingTime);
+
+    EmulatorSettings _g_settings;
+
+    std::vector<uint8_t> _g_eeprom;
+    std::vector<uint8_t> _g_flash;
+
+    std::vector<uint8_t> _g_writeData;
+    std::vector<uint8_t> _g_compressedData;
+
+    uint32_t _g_dataCommands;
+
+    uint8_t _g_memoryModel;
+    uint8_t _g_encoding;
+    uint8_t _g_checksumType;
+    uint32_t _g_baudrate;
+};
+
+#ifndef _WIN32
+
+bool OpenPseudoTerminal(int& masterFd, int& slaveFd, std::string& slavePath);
+
+//Serve the emulator on the master side of a pseudo-terminal until running is false
+void RunEmulator(Emulator& emulator, int masterFd, const std::atomic<bool>& running, EmulatorStats& stats);
+
+#endif //_WIN32
+
+#endif // C_EMULATOR_H_INCLUDED
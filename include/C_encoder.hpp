@@ -0,0 +1,101 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef C_ENCODER_H_INCLUDED
+#define C_ENCODER_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+
+#include "C_range.hpp"
+#include "C_memory.hpp"
+
+#define DEFAULT_READAHEAD 32 //Chunks encoded in advance, on top of the window
+
+struct EncodedChunk
+{
+    uint8_t sequence = 0;
+    uint32_t address = 0;
+    uint32_t numOfData = 0;
+    const uint8_t* data = nullptr;
+    std::string writeFrame; //empty when writing is disabled
+    uint8_t compression = 0; //of the write frame
+    std::string readFrame; //empty when the chunk is not read back immediately
+    std::size_t readReplySize = 0; //0 when the chunk is not read back immediately
+
+    std::chrono::steady_clock::time_point writeSent; //set by the transfer
+    std::chrono::steady_clock::time_point readSent;
+};
+
+/*
+ Read-ahead stage of the transfer : the chunks of the ranges are cut and their frames are built
+ on a separate thread, while the previous frames are on the wire.
+ The chunks are as large as the geometry allows and are aligned on its pages.
+ Every write frame is compressed with the given compressions, the shortest frame is kept (plain included).
+*/
+class ChunkEncoder
+{
+public:
+    //data is indexed by address and must outlive the encoder
+    ChunkEncoder(const uint8_t* data, const AddressRangeList& ranges, const MemoryGeometry& geometry, uint8_t encoding, uint8_t checksumType,
+                 uint8_t compressions, bool buildWrite, bool sequenced, bool buildRead, std::size_t capacity);
+    ~ChunkEncoder();
+
+    ChunkEncoder(const ChunkEncoder&) = delete;
+    ChunkEncoder& operator=(const ChunkEncoder&) = delete;
+
+    //Wait for the next chunk, return false when every chunk was given
+    bool pop(EncodedChunk& chunk);
+    //Give back a chunk that is done with, its buffers are reused for the next chunks
+    void recycle(EncodedChunk&& chunk);
+
+private:
+    void run();
+    void buildWriteFrame(EncodedChunk& chunk);
+
+    const uint8_t* _g_data;
+    AddressRangeList _g_ranges;
+    MemoryGeometry _g_geometry;
+    uint8_t _g_encoding;
+    uint8_t _g_checksumType;
+    uint8_t _g_compressions; //1<<COMPRESSION mask
+    bool _g_buildWrite;
+    bool _g_sequenced;
+    bool _g_buildRead;
+    std::size_t _g_capacity;
+
+    std::vector<uint8_t> _g_compressedData; //of the shortest compression
+    std::vector<uint8_t> _g_candidateData;
+
+    std::deque<EncodedChunk> _g_chunks;
+    std::vector<EncodedChunk> _g_freeChunks;
+    bool _g_finished;
+    bool _g_stopping;
+
+    std::mutex _g_mutex;
+    std::condition_variable _g_chunkReady;
+    std::condition_variable _g_chunkTaken;
+
+    std::thread _g_thread;
+};
+
+#endif // C_ENCODER_H_INCLUDED
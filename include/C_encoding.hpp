@@ -0,0 +1,64 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef C_ENCODING_H_INCLUDED
+#define C_ENCODING_H_INCLUDED
+
+#include <string>
+#include <cstdint>
+
+//Binary encoding : every byte is sent as is, except the protocol characters that are escaped
+#define ENCODING_ESCAPE 0x7D
+#define ENCODING_ESCAPE_XOR 0x20
+
+#define ENCODED_UINT8_MAX_SIZE 3
+
+enum ENCODING : uint8_t
+{
+    ENC_DECIMAL = 0, //3 ASCII digits per byte (default, always supported)
+    ENC_HEX     = 1, //2 ASCII hexadecimal digits per byte
+    ENC_BINARY  = 2, //raw byte, escaped when needed
+
+    ENC_COUNT
+};
+
+enum DECODE_RESULT : uint8_t
+{
+    DECODE_OK = 0,
+    DECODE_INCOMPLETE, //more characters are needed
+    DECODE_INVALID
+};
+
+const char* GetEncodingName(uint8_t encoding);
+bool GetEncodingFromName(const std::string& name, uint8_t& encoding);
+
+std::size_t GetEncodedMinSize(std::size_t numOfData, uint8_t encoding);
+std::size_t GetEncodedMaxSize(std::size_t numOfData, uint8_t encoding);
+std::size_t GetEncodedSize(const uint8_t* data, std::size_t numOfData, uint8_t encoding); //exact size
+
+//The buffer must hold at least GetEncodedMaxSize() characters, return the end of the written characters
+char* WriteEncodedUint8(uint8_t value, uint8_t encoding, char* buffer);
+char* WriteEncodedData(const uint8_t* data, std::size_t numOfData, uint8_t encoding, char* buffer);
+
+void PushEncodedUint8(uint8_t value, uint8_t encoding, std::string& str);
+void PushEncodedData(const uint8_t* data, std::size_t numOfData, uint8_t encoding, std::string& str);
+
+//Check in place that the encoded data at pos is the given data, pos is moved after it on success
+bool MatchEncodedData(const std::string& str, std::size_t& pos, const uint8_t* data, std::size_t numOfData, uint8_t encoding);
+
+uint8_t DecodeUint8(const std::string& str, std::size_t& pos, uint8_t encoding, uint8_t& value);
+
+#endif // C_ENCODING_H_INCLUDED
@@ -0,0 +1,55 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef C_FRAME_H_INCLUDED
+#define C_FRAME_H_INCLUDED
+
+#include <string>
+#include <cstdint>
+
+#define FRAME_WRITED_SIZE 7 //"WRITED\n"
+#define FRAME_WRITEDSEQ_SIZE 10 //"WRITED" + sequence + '\n'
+#define FRAME_READHEADER_SIZE 6
+#define FRAME_CRC_SIZE 12 //"CRC" + 8 hexadecimal digits + '\n'
+#define FRAME_FLASHERASE_SIZE 11 //"$FES" + start and count sectors + '#'
+#define MAX_FLASH_SECTOR 0xFF //The start and count sectors of the erase frame have 2 hexadecimal digits
+#define FRAME_COMPRESSED_OVERHEAD 9 //compression digit + expanded size, on top of a write frame
+
+void BuildEncodingFrame(uint8_t encoding, std::string& frame);
+void BuildBaudrateFrame(uint32_t baudrate, bool hardwareFlowControl, std::string& frame);
+void BuildChecksumFrame(uint8_t checksumType, std::string& frame);
+
+void BuildWriteFrame(uint32_t address, const uint8_t* data, uint32_t numOfData, uint8_t encoding, uint8_t checksumType, std::string& frame);
+void BuildSequencedWriteFrame(uint8_t sequence, uint32_t address, const uint8_t* data, uint32_t numOfData, uint8_t encoding, uint8_t checksumType, std::string& frame);
+//The checksum covers the expanded data, the board checks it after the expansion
+void BuildCompressedWriteFrame(uint32_t address, const uint8_t* data, uint32_t numOfData, uint8_t compression, const uint8_t* compressedData, std::size_t compressedSize,
+                               uint8_t encoding, uint8_t checksumType, std::string& frame);
+void BuildSequencedCompressedWriteFrame(uint8_t sequence, uint32_t address, const uint8_t* data, uint32_t numOfData, uint8_t compression, const uint8_t* compressedData, std::size_t compressedSize,
+                                        uint8_t encoding, uint8_t checksumType, std::string& frame);
+void BuildReadFrame(uint32_t address, uint32_t numOfData, std::string& frame);
+void BuildFlashEraseFrame(uint8_t startSector, uint8_t countSector, std::string& frame);
+void BuildBlankCheckFrame(uint32_t address, uint32_t numOfData, std::string& frame);
+void BuildRangeCrcFrame(uint32_t address, uint32_t numOfData, std::string& frame);
+
+bool GetRangeCrc(const std::string& reply, uint32_t& crc);
+
+//The read reply is checked in place against the expected data
+std::size_t GetReadReplySize(const uint8_t* data, uint32_t numOfData, uint8_t encoding, uint8_t checksumType);
+bool CheckReadReply(const std::string& reply, uint32_t address, const uint8_t* data, uint32_t numOfData, uint8_t encoding, uint8_t checksumType);
+
+bool GetWritedSequence(const std::string& reply, uint8_t& sequence);
+
+#endif // C_FRAME_H_INCLUDED
@@ -0,0 +1,75 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef C_IMAGE_H_INCLUDED
+#define C_IMAGE_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <cstdint>
+
+#include "C_range.hpp"
+
+#define MAX_IMAGE_SIZE 100000000 //The addresses of the frames have 8 decimal digits
+#define IMAGE_FILLER 0xFF //Value of the holes between the segments, never written
+
+/*
+ A memory image is kept flat (the data is indexed by address) with the list of its populated segments,
+ so a segmented input (Intel HEX, Motorola S-record or many binaries) is transferred like a binary
+ while only the segments are written.
+*/
+
+enum IMAGE_FORMAT : uint8_t
+{
+    IMAGE_AUTO   = 0, //From the extension, or else from the content
+    IMAGE_BINARY = 1,
+    IMAGE_IHEX   = 2,
+    IMAGE_SREC   = 3,
+
+    IMAGE_UNKNOWN
+};
+
+struct MemoryImage
+{
+    std::vector<uint8_t> data;
+    AddressRangeList segments; //Sorted and merged by FinishImage
+};
+
+uint8_t GetImageFormat(const std::string& name); //"auto", "binary", "ihex" or "srec", IMAGE_UNKNOWN if not known
+const char* GetImageFormatName(uint8_t format);
+uint8_t GetImageFormatFromPath(const std::string& path); //IMAGE_AUTO if the extension is not known
+uint8_t DetectImageFormat(std::istream& input); //From the first line, the input must be seekable and is not consumed
+
+//An input is "<path>" or "<address>:<path>", the address (decimal or 0x hexadecimal) is only taken when it's a number
+bool SplitImageInput(const std::string& input, uint32_t& address, std::string& path);
+
+//The offset is added to the addresses of the records (modulo 2^32)
+bool ParseIntelHex(std::istream& input, uint32_t offset, MemoryImage& image, std::ostream& log);
+bool ParseSRecord(std::istream& input, uint32_t offset, MemoryImage& image, std::ostream& log);
+bool AddImageData(MemoryImage& image, uint32_t address, const uint8_t* data, std::size_t size, std::ostream& log);
+
+//Sort and merge the segments, the data given twice for the same address is an error
+bool FinishImage(MemoryImage& image, std::ostream& log);
+bool IsFlatImage(const MemoryImage& image); //A single segment from the address 0, like a binary
+
+//Only the bytes of the segments, one after the other, to send a sparse image without its holes
+void PackSegments(const std::vector<uint8_t>& data, const AddressRangeList& segments, std::vector<uint8_t>& packedData);
+//Flat data from the packed bytes, false if their size doesn't match the segments
+bool UnpackSegments(const std::vector<uint8_t>& packedData, const AddressRangeList& segments, std::vector<uint8_t>& data);
+
+#endif // C_IMAGE_H_INCLUDED
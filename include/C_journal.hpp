@@ -0,0 +1,52 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef C_JOURNAL_H_INCLUDED
+#define C_JOURNAL_H_INCLUDED
+
+#include <string>
+#include <cstdint>
+
+#include "C_range.hpp"
+
+#define JOURNAL_ALL_ERASED 0xFFFFFFFF
+
+/*
+ A journal keep the progress of a transfer on a port, so an interrupted transfer
+ can be resumed without erasing and writing again what was already done.
+
+ The journal is only valid for the same image, start address, memory model, delta mode and board.
+ The planned ranges are kept, so a resumed transfer writes and erases the same ranges, even when they came from a delta compare.
+*/
+
+struct TransferJournal
+{
+    uint64_t imageHash = 0;
+    uint32_t startAddress = 0;
+    uint8_t memoryModel = 0;
+    std::string boardIdentity;
+    uint32_t progressAddress = 0; //Every range below this address is written (and verified when immediate)
+    uint32_t erasedAddress = JOURNAL_ALL_ERASED; //Every sector to erase below this address is erased
+    uint8_t deltaMode = 0;
+    AddressRangeList writeRanges; //Planned ranges, before the sparse mode split
+};
+
+std::string GetJournalPath(const std::string& directory, const std::string& portName);
+
+bool LoadJournal(const std::string& path, TransferJournal& journal);
+bool SaveJournal(const std::string& path, const TransferJournal& journal);
+
+#endif // C_JOURNAL_H_INCLUDED
@@ -0,0 +1,48 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef C_LOG_H_INCLUDED
+#define C_LOG_H_INCLUDED
+
+#include <streambuf>
+#include <ostream>
+#include <string>
+#include <mutex>
+
+/*
+ Stream buffer that writes complete lines to a shared output with a prefix,
+ so many transfers can log at the same time without mixing their lines.
+*/
+class PrefixedLogBuffer : public std::streambuf
+{
+public:
+    PrefixedLogBuffer(std::ostream& output, std::mutex& mutex, const std::string& prefix);
+    ~PrefixedLogBuffer() override;
+
+protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char* s, std::streamsize count) override;
+
+private:
+    void writeLine();
+
+    std::ostream& _g_output;
+    std::mutex& _g_mutex;
+    std::string _g_prefix;
+    std::string _g_line;
+};
+
+#endif // C_LOG_H_INCLUDED
@@ -0,0 +1,55 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef C_MANIFEST_H_INCLUDED
+#define C_MANIFEST_H_INCLUDED
+
+#include <string>
+#include <map>
+#include <cstdint>
+
+#include "C_range.hpp"
+
+/*
+ A manifest keep the hash of every sector written on a board, so the next transfer
+ can only erase and write the sectors that changed.
+
+ Only the part of the sector covered by the written data is hashed.
+*/
+
+struct SectorHash
+{
+    uint32_t address;
+    uint32_t size;
+    uint64_t hash;
+};
+
+typedef std::map<uint32_t, SectorHash> SectorHashMap; //key is the sector index
+
+std::string GetBoardIdentity(const std::string& information);
+std::string GetManifestPath(const std::string& directory, const std::string& boardIdentity, uint8_t memoryModel);
+
+bool LoadManifest(const std::string& path, const std::string& boardIdentity, uint32_t sectorSize, SectorHashMap& sectors);
+bool SaveManifest(const std::string& path, const std::string& boardIdentity, uint32_t sectorSize, const SectorHashMap& sectors);
+
+//Sector hashes of a dump, to compare the memory of many boards
+bool SaveSectorHashes(const std::string& path, uint32_t sectorSize, const SectorHashMap& sectors);
+
+void HashSectors(const uint8_t* data, uint32_t address, uint32_t size, uint32_t sectorSize, SectorHashMap& sectors);
+//Each sector is hashed from its first to its last byte covered by the ranges, data is indexed by address
+void HashSectors(const uint8_t* data, const AddressRangeList& ranges, uint32_t sectorSize, SectorHashMap& sectors);
+
+#endif // C_MANIFEST_H_INCLUDED
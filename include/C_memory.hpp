@@ -0,0 +1,70 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef C_MEMORY_H_INCLUDED
+#define C_MEMORY_H_INCLUDED
+
+#include <string>
+#include <cstdint>
+
+#define DEFAULT_NUMOFDATA 100 //Maximum data bytes per write frame of a board that doesn't advertise it
+#define MAX_NUMOFDATA 0xFFFF
+#define DEFAULT_SECTOR_SIZE 4096
+#define DEFAULT_ERASED_VALUE 0xFF
+#define DEFAULT_EEPROM_PAGESIZE 64
+#define DEFAULT_EEPROM_SECTORSIZE 256 //Nothing is erased, only the unit of the delta manifests
+#define DEFAULT_EEPROM_WRITETIME 10000 //us per page
+
+#define TIMING_MARGIN 4 //The write/erase timeouts are this many times the typical times
+#define DEFAULT_WRITE_TIMEOUT 100 //ms per frame, when the board doesn't give its write time
+#define DEFAULT_ERASE_TIMEOUT 1000 //ms per sector, when the board doesn't give its erase time
+
+enum MEMORY_MODEL : uint8_t
+{
+    MEMM_EEPROM = 0,
+    MEMM_FLASH  = 1
+};
+
+/*
+ Geometry of a memory model, the defaults can be overridden by the board in its information string :
+
+ "EEPROM=PAGE:64,PAYLOAD:128,WRITE:5000"
+ "FLASH=PAGE:256,SECTOR:4096,PAYLOAD:512,ERASED:FF,WRITE:700,ERASE:25000"
+*/
+struct MemoryGeometry
+{
+    uint32_t pageSize = 0; //0 when unknown, the chunks are then not aligned
+    uint32_t sectorSize = DEFAULT_SECTOR_SIZE; //Erase unit of the flash, also the unit of the delta manifests
+    uint32_t maxPayload = DEFAULT_NUMOFDATA; //Maximum data bytes per write frame
+    uint8_t erasedValue = DEFAULT_ERASED_VALUE;
+    uint32_t writeTime = 0; //us, typical write time of a page (or of a frame when the page is unknown), 0 when unknown
+    uint32_t eraseTime = 0; //us, typical erase time of a sector, 0 when unknown
+};
+
+const char* GetMemoryModelName(uint8_t memoryModel);
+
+MemoryGeometry GetDefaultGeometry(uint8_t memoryModel);
+//Default geometry with the overrides of the board, false if an override is invalid
+bool GetBoardGeometry(const std::string& information, uint8_t memoryModel, MemoryGeometry& geometry);
+
+//Size of the next write chunk : as large as allowed, ending on a page boundary when it spans many pages
+uint32_t GetChunkSize(const MemoryGeometry& geometry, uint32_t address, uint32_t sizeLeft);
+
+//Longest time (ms) the board can take to process a write frame or an erase of many sectors
+uint32_t GetWriteTimeout(const MemoryGeometry& geometry, uint32_t address, uint32_t numOfData);
+uint32_t GetEraseTimeout(const MemoryGeometry& geometry, uint32_t numOfSectors);
+
+#endif // C_MEMORY_H_INCLUDED
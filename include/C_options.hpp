@@ -0,0 +1,39 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef C_OPTIONS_H_INCLUDED
+#define C_OPTIONS_H_INCLUDED
+
+#include <string>
+#include <ostream>
+#include <cstdint>
+
+#include "C_range.hpp"
+
+struct TransferSettings;
+
+enum OPTION_RESULT : uint8_t
+{
+    OPTION_PARSED = 0,
+    OPTION_UNKNOWN, //not a transfer option
+    OPTION_ERROR    //bad value, the error is logged
+};
+
+//Command line options of a transfer ("--window=8", "--verify", ...), shared by the command line and the daemon jobs
+uint8_t ParseTransferOption(const std::string& option, TransferSettings& settings, std::ostream& log);
+bool CheckTransferSettings(const TransferSettings& settings, std::ostream& log);
+std::string GetSegmentsOption(const AddressRangeList& segments); //"--segments=<address>+<size>,..." of a segmented image
+
+#endif // C_OPTIONS_H_INCLUDED
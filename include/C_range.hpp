@@ -0,0 +1,44 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef C_RANGE_H_INCLUDED
+#define C_RANGE_H_INCLUDED
+
+#include <vector>
+#include <cstdint>
+
+struct AddressRange
+{
+    uint32_t address;
+    uint32_t size;
+};
+
+typedef std::vector<AddressRange> AddressRangeList;
+
+void PushRange(AddressRangeList& ranges, uint32_t address, uint32_t size); //merged with the last range when contiguous
+uint64_t GetRangesSize(const AddressRangeList& ranges);
+bool CheckRanges(const AddressRangeList& ranges, uint64_t endAddress); //not empty, sorted without overlap and ending at most at endAddress
+void TrimRanges(AddressRangeList& ranges, uint32_t address); //remove everything below the address
+void IntersectRanges(const AddressRangeList& ranges, uint32_t address, uint32_t size, AddressRangeList& intersection); //the parts of the sorted ranges in [address, address+size)
+
+void GetSectorRanges(const AddressRangeList& ranges, uint32_t sectorSize, AddressRangeList& sectors); //every sector touched by the ranges
+//data is indexed by address
+void SplitBlankRanges(const uint8_t* data, const AddressRangeList& ranges, uint32_t chunkSize, uint8_t erasedValue,
+                      AddressRangeList& dataRanges, AddressRangeList& blankRanges);
+//Merge the ranges separated by up to maxGap bytes that all have the value, data is indexed by address
+void CoalesceRanges(const uint8_t* data, AddressRangeList& ranges, uint32_t maxGap, uint8_t value);
+
+#endif // C_RANGE_H_INCLUDED
@@ -0,0 +1,65 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef C_STATS_H_INCLUDED
+#define C_STATS_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+#include <chrono>
+#include <cstdint>
+
+#define STATS_HISTOGRAM_SIZE 24 //Latency buckets, bucket n counts the latencies below 2^n us, the last one the rest
+
+typedef std::chrono::steady_clock StatsClock;
+
+struct CommandStats
+{
+    uint32_t count = 0;
+    uint64_t sentBytes = 0;
+    uint64_t receivedBytes = 0;
+    std::vector<uint32_t> latencies; //us, from the command sent to its reply received
+};
+
+/*
+ Telemetry of a transfer, every function accepts a null stats pointer and then does nothing.
+*/
+struct TransferStats
+{
+    std::string port;
+    int result = -1;
+
+    std::vector<std::pair<std::string, uint64_t> > phases; //us, in order
+    std::map<std::string, CommandStats> commands; //by command name ("W", "R", "FES", ...)
+
+    uint64_t payloadBytes = 0; //data bytes written, or verified when writing is disabled
+    uint32_t retries = 0;
+    uint64_t totalTime = 0; //us
+};
+
+//Add the time since phaseStart to the phase and start the next one
+void EndPhase(TransferStats* stats, const std::string& name, StatsClock::time_point& phaseStart);
+void RecordCommand(TransferStats* stats, const std::string& name, std::size_t sentBytes, std::size_t receivedBytes, StatsClock::time_point sent);
+
+uint64_t GetWireBytes(const TransferStats& stats);
+uint32_t GetPercentile(std::vector<uint32_t> latencies, unsigned int percentile);
+
+void PrintStats(const TransferStats& stats, std::ostream& out); //Human summary
+void WriteStatsJson(const std::vector<TransferStats>& stats, std::ostream& out);
+
+#endif // C_STATS_H_INCLUDED
@@ -19,10 +19,24 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 
 size_t Split(const std::string& str, std::vector<std::string>& buff, char delimiter);
 
+#define UINT8_STRING_SIZE 3
+#define UINT24_STRING_SIZE 8
+
+const char* GetUint8Digits(uint8_t value); //the 3 decimal digits of the value (not null terminated)
+
+char* WriteUint8InBuffer(uint8_t value, char* buffer); //return the end of the written digits
+char* WriteUint24InBuffer(uint32_t value, char* buffer);
+
 void PushUint8InString(uint8_t value, std::string& str);
 void PushUint24InString(uint32_t value, std::string& str);
+void PushUint32HexInString(uint32_t value, std::string& str); //8 hexadecimal digits
+
+bool GetUint8FromString(const std::string& str, std::size_t pos, uint8_t& value);
+bool GetUint24FromString(const std::string& str, std::size_t pos, uint32_t& value);
+bool GetUint32FromHexString(const std::string& str, std::size_t pos, uint32_t& value); //8 hexadecimal digits
 
 #endif // C_STRING_H_INCLUDED
@@ -0,0 +1,209 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef C_TRACE_H_INCLUDED
+#define C_TRACE_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <fstream>
+#include <ostream>
+#include <cstdint>
+
+#include "C_transport.hpp"
+#include "C_stats.hpp"
+
+#define TRACE_MAGIC "CGTTRACE"
+#define TRACE_VERSION 2
+
+//Trace events
+#define TRACE_WRITE 'W'
+#define TRACE_READ 'R'
+#define TRACE_FLUSH 'S' //Wait until everything is sent
+#define TRACE_FLUSHINPUT 'I'
+#define TRACE_BAUDRATE 'B'
+#define TRACE_END 'E'
+
+#define TRACE_BLOCKED_TIME 100 //us, a read that took longer waited for its data
+
+/*
+ A port call, the times are in us from the start of the trace.
+ A read keeps what it returned, an empty read is a timeout.
+*/
+struct TraceEvent
+{
+    char type = TRACE_END;
+    uint64_t start = 0;
+    uint64_t duration = 0;
+    std::string data; //Written or received bytes
+    uint32_t baudrate = 0; //TRACE_BAUDRATE only
+};
+
+/*
+ Everything needed to run the same transfer again without the board :
+ the transfer options, the input data and every port call.
+*/
+struct Trace
+{
+    std::string version;
+    std::string portName;
+    uint32_t baudrate = 0; //When the port was opened
+    bool lineConfigurable = true;
+    bool wireLimited = true; //false for the loopback, the wire times are then 0
+    std::vector<std::string> options;
+    std::vector<uint8_t> input;
+    std::vector<TraceEvent> events;
+};
+
+/*
+ Transport that records every call to another one in a binary trace file.
+
+ The file is made of a header and of one record per call :
+ type, start (delta from the previous call), duration and the data, as unsigned LEB128 numbers.
+*/
+class RecordingTransport : public Transport
+{
+public:
+    RecordingTransport(std::unique_ptr<Transport> port, const std::string& path);
+    ~RecordingTransport() override;
+
+    //Write the header, return false if the file can't be written
+    bool start(const std::vector<std::string>& options, const std::vector<uint8_t>& input);
+
+    std::string getName() const override;
+
+    std::size_t write(const std::string& data) override;
+    std::string read(std::size_t size) override;
+    std::string readLine(std::size_t maxSize) override;
+
+    void flush() override;
+    void flushInput() override;
+
+    void setReadTimeout(uint32_t timeout) override;
+
+    bool isLineConfigurable() const override;
+    bool isWireLimited() const override;
+    uint32_t getBaudrate() const override;
+    void setBaudrate(uint32_t baudrate) override;
+    void setHardwareFlowControl(bool enabled) override;
+
+private:
+    void record(char type, StatsClock::time_point start, const std::string& data, uint32_t baudrate = 0);
+
+    std::unique_ptr<Transport> _g_port;
+    std::ofstream _g_file;
+    StatsClock::time_point _g_origin;
+    uint64_t _g_lastStart;
+};
+
+/*
+ Transport that plays the board side of a trace.
+
+ The written bytes are compared to the recorded ones, a recorded reply is only received once the
+ host wrote everything that was written before it, after the recorded delay multiplied by the time scale
+ (0 to receive it as soon as possible). A reply that can't come any more returns right away instead of waiting the timeout.
+*/
+class ReplayTransport : public Transport
+{
+public:
+    ReplayTransport(const Trace& trace, double timeScale);
+
+    std::string getName() const override;
+
+    std::size_t write(const std::string& data) override;
+    std::string read(std::size_t size) override;
+    std::string readLine(std::size_t maxSize) override;
+
+    void flush() override;
+    void flushInput() override;
+
+    void setReadTimeout(uint32_t timeout) override;
+
+    bool isLineConfigurable() const override;
+    bool isWireLimited() const override;
+    uint32_t getBaudrate() const override;
+    void setBaudrate(uint32_t baudrate) override;
+    void setHardwareFlowControl(bool enabled) override;
+
+    bool isDiverged() const; //The host wrote something else than the recorded bytes
+    uint64_t getDivergenceOffset() const; //Of the first different written byte
+    uint64_t getWaitTime() const; //us spent waiting for the replies
+
+private:
+    struct Reply
+    {
+        std::string data;
+        uint64_t writtenSize; //Written before the reply
+        uint32_t flushCount; //Input flushes before the reply
+        uint64_t delay; //us, from the last write or input flush before the reply
+        bool gated = false;
+        StatsClock::time_point availableTime;
+    };
+
+    void openGates(); //Date the replies the host can now receive
+    void receive(std::size_t size, bool line); //Wait for the replies until size bytes or a line are received
+
+    std::string _g_written; //Recorded written bytes
+    std::vector<Reply> _g_replies;
+    std::size_t _g_nextReply; //First reply not received yet
+    std::size_t _g_nextGate; //First reply the host can't receive yet
+    std::string _g_buffer;
+    uint64_t _g_writtenSize;
+    uint32_t _g_flushCount;
+    bool _g_diverged;
+    uint64_t _g_divergenceOffset;
+    uint64_t _g_waitTime;
+    double _g_timeScale;
+    uint32_t _g_baudrate;
+    bool _g_lineConfigurable;
+    bool _g_wireLimited;
+};
+
+/*
+ Where the time of a trace went, all in us.
+
+ host : between the port calls (building and checking the frames)
+ wire : the bytes on the line at the recorded baudrates
+ board : from the end of a command on the wire (or of the previous reply) to its reply, minus the wire time of the reply
+ With a window the wire and board times overlap, they don't add up to the total.
+*/
+struct TraceCommandReport
+{
+    std::vector<uint32_t> turnarounds; //From the command written to its reply received
+    std::vector<uint32_t> boardTimes;
+};
+struct TraceReport
+{
+    uint64_t total = 0;
+    uint64_t host = 0;
+    uint64_t wait = 0; //In the port calls
+    uint64_t wireSent = 0;
+    uint64_t wireReceived = 0;
+    uint64_t board = 0;
+    uint64_t sentBytes = 0;
+    uint64_t receivedBytes = 0;
+    uint32_t timeouts = 0;
+    std::map<std::string, TraceCommandReport> commands; //by command name ("W", "R", "FES", ...)
+};
+
+bool LoadTrace(const std::string& path, Trace& trace, std::ostream& log);
+
+void AnalyseTrace(const Trace& trace, TraceReport& report);
+void PrintTraceReport(const TraceReport& report, std::ostream& out);
+void PrintTraceComparison(const TraceReport& reference, const TraceReport& other, std::ostream& out);
+
+#endif // C_TRACE_H_INCLUDED
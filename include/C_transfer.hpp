@@ -0,0 +1,155 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef C_TRANSFER_H_INCLUDED
+#define C_TRANSFER_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <functional>
+#include <cstdint>
+
+#include "C_transport.hpp"
+#include "C_encoding.hpp"
+#include "C_checksum.hpp"
+#include "C_compression.hpp"
+#include "C_memory.hpp"
+#include "C_stats.hpp"
+#include "C_range.hpp"
+
+#define MAX_INFOSIZE 256
+#define MAX_REPLYSIZE 40 //Replies read up to their terminator, except the information
+#define REPLY_TIMEOUT 1000 //ms, reply of a command on top of its wire time and processing
+#define RANGE_TIMEOUT 10 //ms per KB processed by the board for a blank check or a range CRC
+#define DEFAULT_BAUDRATE 9600
+#define BAUDRATE_SETTLE_DELAY 20 //ms, let the board switch its UART
+#define BAUDRATE_FALLBACK_DELAY 1000 //ms, the board returns to its previous rate if no hello is received
+#define MAX_WINDOWSIZE 255
+#define DEFAULT_VERIFYBLOCK 4096
+#define MAX_VERIFYBLOCK 0xFFFFFF
+#define DEFAULT_DUMPBLOCK 0x10000
+#define MAX_BLANKCHECKSIZE 0xFFFFFF
+#define MAX_CRCSIZE 0xFFFFFF
+#define DEFAULT_RETRYCOUNT 3 //Retries of a failed chunk
+#define MAX_ERASEAHEAD 255
+#define RESYNC_TIMEOUT 10000 //ms, to drop the replies in flight and get the board hello
+#define PROBE_TIMEOUT 300 //ms, for a board to answer the hello when the ports are searched
+#define READ_STREAM_SIZE 256 //Decoded bytes per serial read while streaming a read-back
+
+enum VERIFY_MODE : uint8_t
+{
+    VERIFY_IMMEDIATE = 0,
+    VERIFY_DEFERRED  = 1,
+    VERIFY_CRC       = 2  //Deferred, with a CRC computed by the board
+};
+
+enum DELTA_MODE : uint8_t
+{
+    DELTA_DISABLED = 0,
+    DELTA_AUTO     = 1, //Compare with the manifest if any, or with the board memory
+    DELTA_READBACK = 2  //Always compare with the board memory
+};
+
+struct TransferSettings
+{
+    uint8_t memoryModel = MEMM_EEPROM;
+    uint32_t startAddress = 0;
+    AddressRangeList segments; //Populated ranges of a segmented image, empty when the whole file is populated
+
+    bool enableWrite = true;
+    bool enableFlashErase = true;
+    unsigned int eraseAhead = 0; //Sectors erased ahead of the write cursor, 0 to erase every sector before writing
+
+    unsigned int windowSize = 1;
+    uint8_t verifyMode = VERIFY_IMMEDIATE;
+    uint32_t verifyBlockSize = DEFAULT_VERIFYBLOCK;
+    uint32_t dumpBlockSize = DEFAULT_DUMPBLOCK;
+
+    uint32_t targetBaudrate = DEFAULT_BAUDRATE;
+    bool hardwareFlowControl = false;
+
+    bool autoEncoding = true;
+    uint8_t encoding = ENC_DECIMAL;
+
+    bool autoChecksum = true;
+    uint8_t checksumType = CHECKSUM_SUM8;
+
+    bool autoCompression = true; //Every compression of the board
+    uint8_t compression = COMP_NONE;
+
+    uint8_t deltaMode = DELTA_DISABLED;
+    std::string manifestDirectory; //Also for the journals
+
+    bool sparseMode = false;
+
+    unsigned int retryCount = DEFAULT_RETRYCOUNT;
+    bool resume = false;
+
+    bool quiet = false; //No log line per chunk
+};
+
+//State of the board after the handshake, it can be kept between transfers while the port stays opened
+struct BoardSession
+{
+    std::string information;
+    uint8_t encoding = ENC_DECIMAL;
+    uint8_t checksumType = CHECKSUM_SUM8;
+    uint8_t memoryModel = MEMM_EEPROM;
+    MemoryGeometry geometry;
+};
+
+typedef std::function<bool(uint32_t address, const uint8_t* data, uint32_t numOfData)> ReadRangeCallback;
+
+uint32_t GetWireTime(const Transport& port, std::size_t size); //ms to send size characters at the port baudrate
+void SetReplyTimeout(Transport& port, uint32_t timeout); //ms, no inter-byte timeout : the reads end on their size
+std::string ReadReply(Transport& port, uint32_t timeout, std::size_t maxSize = MAX_REPLYSIZE); //Up to the '\n' terminator
+
+bool ReadAtLeast(Transport& port, std::string& buffer, std::size_t& pos, std::size_t size, uint32_t timeout = REPLY_TIMEOUT);
+bool ReadEncodedUint8(Transport& port, std::string& buffer, std::size_t& pos, uint8_t encoding, std::size_t minRemaining, uint8_t& value);
+
+bool ReadRange(Transport& port, uint32_t address, uint32_t numOfData, uint8_t encoding, uint8_t checksumType, const ReadRangeCallback& callback, std::ostream& log, TransferStats* stats = nullptr);
+bool VerifyRange(Transport& port, const uint8_t* data, uint32_t address, uint32_t size, uint32_t blockSize, uint8_t encoding, uint8_t checksumType, std::ostream& log, TransferStats* stats = nullptr);
+//Read the range into the data with up to windowSize requests in flight, the blocks with a bad reply are read again
+bool DumpRange(Transport& port, uint8_t* data, uint32_t address, uint32_t size, const TransferSettings& settings, const BoardSession& session, std::ostream& log, TransferStats* stats = nullptr);
+bool CompareRange(Transport& port, const uint8_t* data, uint32_t address, uint32_t size, uint32_t blockSize, uint8_t encoding, uint8_t checksumType, bool& identical, std::ostream& log, TransferStats* stats = nullptr);
+
+//The board computes a CRC-32 over the range ($C command), the data is read back only on a mismatch to find it
+bool ReadRangeCrc(Transport& port, uint32_t address, uint32_t numOfData, uint32_t& crc, std::ostream& log, TransferStats* stats = nullptr);
+bool VerifyRangeCrc(Transport& port, const uint8_t* data, uint32_t address, uint32_t size, uint32_t blockSize, uint8_t encoding, uint8_t checksumType, std::ostream& log, TransferStats* stats = nullptr);
+bool CompareRangeCrc(Transport& port, const uint8_t* data, uint32_t address, uint32_t size, bool& identical, std::ostream& log, TransferStats* stats = nullptr);
+bool BlankCheckRange(Transport& port, uint32_t address, uint32_t size, std::ostream& log, TransferStats* stats = nullptr);
+
+bool SayHello(Transport& port);
+//Check if a board answers the hello within the timeout (other lines are ignored), its information (with the terminator, as in the session) is read when asked
+bool ProbeBoard(Transport& port, uint32_t timeout, std::string* information = nullptr);
+//Get the board back to a known state after a bad reply, the replies in flight are dropped
+bool Resync(Transport& port);
+bool NegotiateBaudrate(Transport& port, const std::string& information, uint32_t targetBaudrate, bool hardwareFlowControl, std::ostream& log);
+
+//Hello, board information, baudrate, encoding, checksum and memory model, the port must be opened at DEFAULT_BAUDRATE
+bool OpenSession(Transport& port, const TransferSettings& settings, BoardSession& session, std::ostream& log, TransferStats* stats = nullptr);
+bool SelectMemoryModel(Transport& port, uint8_t memoryModel, BoardSession& session, std::ostream& log, TransferStats* stats = nullptr);
+
+//Transfer (write and/or verify) the file data into the board memory, the port must be opened at DEFAULT_BAUDRATE
+int TransferFile(Transport& port, const std::vector<uint8_t>& fileData, const TransferSettings& settings, std::ostream& log, TransferStats* stats = nullptr);
+//Same with an opened session, its memory model must be the one of the settings
+int TransferFile(Transport& port, const std::vector<uint8_t>& fileData, const TransferSettings& settings, const BoardSession& session, std::ostream& log, TransferStats* stats = nullptr);
+
+//Read the board memory range into the data with an opened session, its memory model must be the one of the settings
+int DumpMemory(Transport& port, uint32_t address, uint32_t size, std::vector<uint8_t>& data, const TransferSettings& settings, const BoardSession& session, std::ostream& log, TransferStats* stats = nullptr);
+
+#endif // C_TRANSFER_H_INCLUDED
@@ -0,0 +1,182 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef C_TRANSPORT_H_INCLUDED
+#define C_TRANSPORT_H_INCLUDED
+
+#include <string>
+#include <memory>
+#include <ostream>
+#include <mutex>
+#include <cstdint>
+
+#include "serial/serial.h"
+#include "C_emulator.hpp"
+
+#define TRANSPORT_TCP_PREFIX "tcp://"
+#define TRANSPORT_LOOPBACK_NAME "loopback"
+#define TCP_CONNECT_TIMEOUT 5000 //ms
+#define TCP_RECEIVE_BLOCK 4096
+
+/*
+ The byte stream to a board, the protocol only use this interface.
+
+ The reads wait up to the read timeout and return what was received, that can be less than the size.
+ The baudrate of a port that can't change its line settings is only used to compute the wire times.
+*/
+class Transport
+{
+public:
+    virtual ~Transport() = default;
+
+    virtual std::string getName() const = 0;
+
+    virtual std::size_t write(const std::string& data) = 0;
+    virtual std::string read(std::size_t size) = 0;
+    virtual std::string readLine(std::size_t maxSize) = 0; //Up to the '\n' terminator, included
+
+    virtual void flush() = 0; //Wait until everything is sent
+    virtual void flushInput() = 0; //Drop everything received
+
+    virtual void setReadTimeout(uint32_t timeout) = 0; //ms
+
+    virtual bool isLineConfigurable() const = 0;
+    virtual bool isWireLimited() const = 0; //false when the bytes don't go through a line at the baudrate
+    virtual uint32_t getBaudrate() const = 0;
+    virtual void setBaudrate(uint32_t baudrate) = 0;
+    virtual void setHardwareFlowControl(bool enabled) = 0;
+};
+
+class SerialTransport : public Transport
+{
+public:
+    //The port is opened at the baudrate, throws a serial exception on failure
+    SerialTransport(const std::string& portName, uint32_t baudrate, uint32_t timeout);
+
+    std::string getName() const override;
+
+    std::size_t write(const std::string& data) override;
+    std::string read(std::size_t size) override;
+    std::string readLine(std::size_t maxSize) override;
+
+    void flush() override;
+    void flushInput() override;
+
+    void setReadTimeout(uint32_t timeout) override;
+
+    bool isLineConfigurable() const override;
+    bool isWireLimited() const override;
+    uint32_t getBaudrate() const override;
+    void setBaudrate(uint32_t baudrate) override;
+    void setHardwareFlowControl(bool enabled) override;
+
+    bool isOpen() const;
+
+private:
+    serial::Serial _g_port;
+    uint32_t _g_timeout;
+};
+
+#ifndef _WIN32
+
+/*
+ Raw TCP connection to a serial port server (e.g. ser2net in raw mode), the line settings are the ones of the server.
+ The receive side is buffered here, the Nagle algorithm is disabled as every write is a complete small frame.
+*/
+class TcpTransport : public Transport
+{
+public:
+    TcpTransport(const std::string& host, const std::string& service, uint32_t baudrate, uint32_t timeout);
+    ~TcpTransport() override;
+
+    TcpTransport(const TcpTransport&) = delete;
+    TcpTransport& operator=(const TcpTransport&) = delete;
+
+    //Connect to the server, return false on failure with the reason in the error
+    bool connect(std::string& error);
+
+    std::string getName() const override;
+
+    std::size_t write(const std::string& data) override;
+    std::string read(std::size_t size) override;
+    std::string readLine(std::size_t maxSize) override;
+
+    void flush() override;
+    void flushInput() override;
+
+    void setReadTimeout(uint32_t timeout) override;
+
+    bool isLineConfigurable() const override;
+    bool isWireLimited() const override;
+    uint32_t getBaudrate() const override;
+    void setBaudrate(uint32_t baudrate) override;
+    void setHardwareFlowControl(bool enabled) override;
+
+private:
+    bool receive(int timeout); //ms, append what is available to the buffer, false on timeout or on a closed connection
+
+    std::string _g_host;
+    std::string _g_service;
+    int _g_fd;
+    std::string _g_buffer;
+    std::size_t _g_bufferPos;
+    uint32_t _g_baudrate;
+    uint32_t _g_timeout;
+};
+
+#endif //_WIN32
+
+/*
+ In-memory loopback to an emulated board, the commands are executed as soon as they are written
+ without any wire or processing time, to measure the protocol overhead of the host.
+*/
+class LoopbackTransport : public Transport
+{
+public:
+    explicit LoopbackTransport(const EmulatorSettings& settings);
+
+    std::string getName() const override;
+
+    std::size_t write(const std::string& data) override;
+    std::string read(std::size_t size) override;
+    std::string readLine(std::size_t maxSize) override;
+
+    void flush() override;
+    void flushInput() override;
+
+    void setReadTimeout(uint32_t timeout) override;
+
+    bool isLineConfigurable() const override;
+    bool isWireLimited() const override;
+    uint32_t getBaudrate() const override;
+    void setBaudrate(uint32_t baudrate) override;
+    void setHardwareFlowControl(bool enabled) override;
+
+    const Emulator& getEmulator() const;
+
+private:
+    std::mutex _g_mutex;
+    Emulator _g_emulator;
+    std::string _g_frame;
+    bool _g_inFrame;
+    std::string _g_buffer;
+    std::size_t _g_bufferPos;
+    uint32_t _g_baudrate;
+};
+
+//Open the transport named by the port : "tcp://<host>:<port>", "loopback" or a serial port name
+std::unique_ptr<Transport> OpenTransport(const std::string& portName, std::ostream& log);
+
+#endif // C_TRANSPORT_H_INCLUDED
@@ -18,13 +18,45 @@
 #define MAIN_H_INCLUDED
 
 #include <string>
+#include <vector>
+#include <memory>
+#include <istream>
+#include <ostream>
 #include <cstdint>
 
+struct TransferSettings;
+struct TransferStats;
+struct MemoryImage;
+class Transport;
+
+#define INPUT_BLOCK_SIZE 65536
+#define PORT_AUTO "auto" //Search the boards on every port
+
+//Trace of the port calls, with the options needed to replay them
+struct TraceRecord
+{
+    std::string path; //Empty to not record
+    std::vector<std::string> options;
+};
+
 void ShowAllPorts();
+//Probe every available port at the same time, give the ones where a board (matching the board ID if not empty) answers
+bool FindBoardPorts(const std::string& boardId, uint32_t timeout, std::vector<std::string>& portNames, std::ostream& log);
+bool ReadInput(std::istream& input, std::vector<uint8_t>& data);
+//Load the inputs ("[<address>:]<path>,..."), the format of each one is detected when auto
+bool LoadInputImage(const std::string& inputs, uint8_t format, MemoryImage& image, std::ostream& log);
+//Open the port, recorded when the trace has a path
+std::unique_ptr<Transport> OpenPort(const std::string& portName, const TraceRecord& record, const std::vector<uint8_t>& input, std::ostream& log);
+//Also fill the port, the result and the total time of the stats
+int TransferToPort(const std::string& portName, const std::vector<uint8_t>& fileData, const TransferSettings& settings, const TraceRecord& record, std::ostream& log, TransferStats& stats);
+//Read length bytes from the start address of the settings, also give the sector size of the board for the hashes
+int DumpFromPort(const std::string& portName, uint32_t length, const TransferSettings& settings, const TraceRecord& record, std::vector<uint8_t>& data, uint32_t& sectorSize, std::ostream& log, TransferStats& stats);
+//Print the statistics of every port and write them as JSON if the path isn't empty
+bool OutputStats(const std::vector<TransferStats>& stats, const std::string& statsPath);
 
 void PrintHelp();
 void PrintVersion();
 
-uint8_t CalculateChecksum(uint8_t* data, uint8_t numOfData);
+uint8_t CalculateChecksum(const uint8_t* data, uint8_t numOfData);
 
 #endif // MAIN_H_INCLUDED
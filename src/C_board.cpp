@@ -0,0 +1,160 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "C_board.hpp"
+#include "C_encoding.hpp"
+#include "C_checksum.hpp"
+#include "C_compression.hpp"
+#include "C_string.hpp"
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+bool GetBoardCapability(const std::string& information, const std::string& key, std::string& value)
+{
+    std::string::size_type tokenStart = 0;
+    while (tokenStart < information.size())
+    {
+        std::string::size_type tokenEnd = information.find_first_of(" \t\r\n;", tokenStart);
+        if (tokenEnd == std::string::npos)
+        {
+            tokenEnd = information.size();
+        }
+
+        if ( tokenEnd-tokenStart > key.size() &&
+             information.compare(tokenStart, key.size(), key) == 0 &&
+             information[tokenStart+key.size()] == '=' )
+        {
+            value = information.substr(tokenStart+key.size()+1, tokenEnd-tokenStart-key.size()-1);
+            return true;
+        }
+
+        tokenStart = tokenEnd+1;
+    }
+    return false;
+}
+bool HasBoardCapabilityValue(const std::string& information, const std::string& key, const std::string& value)
+{
+    std::string values;
+    if ( !GetBoardCapability(information, key, values) )
+    {
+        return false;
+    }
+
+    std::vector<std::string> splitedValues;
+    Split(values, splitedValues, ',');
+    for (const std::string& splitedValue : splitedValues)
+    {
+        if (splitedValue == value)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+bool HasBoardCommand(const std::string& information, const std::string& command)
+{
+    return HasBoardCapabilityValue(information, "CMD", command);
+}
+
+uint8_t GetBoardEncodings(const std::string& information)
+{
+    uint8_t encodings = 1<<ENC_DECIMAL; //Always supported
+
+    if ( HasBoardCapabilityValue(information, "ENC", "HEX") )
+    {
+        encodings |= 1<<ENC_HEX;
+    }
+    if ( HasBoardCapabilityValue(information, "ENC", "BIN") )
+    {
+        encodings |= 1<<ENC_BINARY;
+    }
+    return encodings;
+}
+uint8_t GetBestEncoding(uint8_t encodings)
+{
+    //From the densest to the less dense
+    if (encodings & (1<<ENC_BINARY))
+    {
+        return ENC_BINARY;
+    }
+    if (encodings & (1<<ENC_HEX))
+    {
+        return ENC_HEX;
+    }
+    return ENC_DECIMAL;
+}
+
+uint8_t GetBoardChecksums(const std::string& information)
+{
+    uint8_t checksums = 1<<CHECKSUM_SUM8; //Always supported
+
+    if ( HasBoardCapabilityValue(information, "CHK", "CRC32") )
+    {
+        checksums |= 1<<CHECKSUM_CRC32;
+    }
+    return checksums;
+}
+uint8_t GetBestChecksum(uint8_t checksums)
+{
+    return (checksums & (1<<CHECKSUM_CRC32)) ? CHECKSUM_CRC32 : CHECKSUM_SUM8;
+}
+
+uint8_t GetBoardCompressions(const std::string& information)
+{
+    uint8_t compressions = 1<<COMP_NONE; //Always supported
+
+    if ( HasBoardCapabilityValue(information, "COMP", "RLE") )
+    {
+        compressions |= 1<<COMP_RLE;
+    }
+    if ( HasBoardCapabilityValue(information, "COMP", "LZ") )
+    {
+        compressions |= 1<<COMP_LZ;
+    }
+    return compressions;
+}
+
+std::size_t GetBoardBaudrates(const std::string& information, std::vector<uint32_t>& baudrates)
+{
+    std::string values;
+    if ( !GetBoardCapability(information, "BAUD", values) )
+    {
+        return baudrates.size();
+    }
+
+    std::vector<std::string> splitedValues;
+    Split(values, splitedValues, ',');
+    for (const std::string& splitedValue : splitedValues)
+    {
+        try
+        {
+            baudrates.push_back(std::stoul(splitedValue));
+        }
+        catch (std::exception&)
+        {
+            continue;
+        }
+    }
+
+    std::sort(baudrates.begin(), baudrates.end(), std::greater<uint32_t>());
+    baudrates.erase(std::unique(baudrates.begin(), baudrates.end()), baudrates.end());
+    return baudrates.size();
+}
+bool HasBoardHardwareFlowControl(const std::string& information)
+{
+    return HasBoardCapabilityValue(information, "FLOW", "RTSCTS");
+}
@@ -16,7 +16,44 @@
 
 #include "C_checksum.hpp"
 
-uint8_t CalculateChecksum(uint8_t* data, uint8_t numOfData)
+namespace
+{
+
+const char* const gChecksumNames[CHECKSUM_COUNT] = {"sum", "crc32"};
+
+//Slicing-by-8 tables of the reflected CRC-32 polynomial
+struct Crc32Table
+{
+    constexpr Crc32Table() :
+        _values()
+    {
+        for (uint32_t i=0; i<256; ++i)
+        {
+            uint32_t crc = i;
+            for (int bit=0; bit<8; ++bit)
+            {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : (crc >> 1);
+            }
+            this->_values[0][i] = crc;
+        }
+        for (uint32_t i=0; i<256; ++i)
+        {
+            for (int slice=1; slice<8; ++slice)
+            {
+                uint32_t previous = this->_values[slice-1][i];
+                this->_values[slice][i] = (previous >> 8) ^ this->_values[0][previous & 0xFF];
+            }
+        }
+    }
+
+    uint32_t _values[8][256];
+};
+
+constexpr Crc32Table gCrc32Table;
+
+} // namespace
+
+uint8_t CalculateChecksum(const uint8_t* data, uint8_t numOfData)
 {
     uint8_t checksum = 0;
     for (unsigned int i=0; i<numOfData; ++i)
@@ -25,3 +62,86 @@ uint8_t CalculateChecksum(uint8_t* data, uint8_t numOfData)
     }
     return checksum;
 }
+
+uint32_t UpdateCrc32(uint32_t crc, const uint8_t* data, std::size_t size)
+{
+    const auto& table = gCrc32Table._values;
+
+    while (size >= 8)
+    {
+        uint32_t low = crc ^ (static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1])<<8 |
+                              static_cast<uint32_t>(data[2])<<16 | static_cast<uint32_t>(data[3])<<24);
+        crc = table[7][low & 0xFF] ^ table[6][(low>>8) & 0xFF] ^ table[5][(low>>16) & 0xFF] ^ table[4][low>>24] ^
+              table[3][data[4]] ^ table[2][data[5]] ^ table[1][data[6]] ^ table[0][data[7]];
+        data += 8;
+        size -= 8;
+    }
+    while (size > 0)
+    {
+        crc = (crc >> 8) ^ table[0][(crc ^ *data) & 0xFF];
+        ++data;
+        --size;
+    }
+    return crc;
+}
+uint32_t FinalizeCrc32(uint32_t crc)
+{
+    return crc ^ 0xFFFFFFFF;
+}
+uint32_t CalculateCrc32(const uint8_t* data, std::size_t size)
+{
+    return FinalizeCrc32(UpdateCrc32(CRC32_INIT, data, size));
+}
+
+const char* GetChecksumName(uint8_t checksumType)
+{
+    return (checksumType < CHECKSUM_COUNT) ? gChecksumNames[checksumType] : "unknown";
+}
+bool GetChecksumFromName(const std::string& name, uint8_t& checksumType)
+{
+    for (uint8_t i=0; i<CHECKSUM_COUNT; ++i)
+    {
+        if (name == gChecksumNames[i])
+        {
+            checksumType = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t GetChecksumSize(uint8_t checksumType)
+{
+    return (checksumType == CHECKSUM_CRC32) ? 4 : 1;
+}
+uint8_t GetChecksumBytes(const uint8_t* data, std::size_t numOfData, uint8_t checksumType, uint8_t* checksum)
+{
+    if (checksumType == CHECKSUM_CRC32)
+    {
+        uint32_t crc = CalculateCrc32(data, numOfData);
+        checksum[0] = static_cast<uint8_t>(crc >> 24);
+        checksum[1] = static_cast<uint8_t>(crc >> 16);
+        checksum[2] = static_cast<uint8_t>(crc >> 8);
+        checksum[3] = static_cast<uint8_t>(crc);
+        return 4;
+    }
+
+    uint8_t sum = 0;
+    for (std::size_t i=0; i<numOfData; ++i)
+    {
+        sum += data[i];
+    }
+    checksum[0] = sum;
+    return 1;
+}
+
+uint64_t CalculateHash(const uint8_t* data, std::size_t size)
+{
+    uint64_t hash = 0xCBF29CE484222325;
+    for (std::size_t i=0; i<size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 0x00000100000001B3;
+    }
+    return hash;
+}
@@ -0,0 +1,237 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+#include "C_compression.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+const char* const gCompressionNames[COMP_COUNT] = {"none", "rle", "lz"};
+
+const uint32_t gNoPosition = 0xFFFFFFFF;
+
+uint8_t* WriteLiterals(const uint8_t* data, std::size_t size, uint8_t* buffer)
+{
+    while (size > 0)
+    {
+        const std::size_t count = std::min<std::size_t>(size, COMPRESSION_MAX_LITERALS);
+        *buffer++ = static_cast<uint8_t>(count-1);
+        std::memcpy(buffer, data, count);
+        buffer += count;
+        data += count;
+        size -= count;
+    }
+    return buffer;
+}
+
+inline uint32_t GetLzHash(const uint8_t* data)
+{
+    const uint32_t value = (static_cast<uint32_t>(data[0])<<24) | (static_cast<uint32_t>(data[1])<<16) |
+                           (static_cast<uint32_t>(data[2])<<8) | data[3];
+    return (value * 2654435761u) >> (32-COMPRESSION_LZ_HASH_BITS);
+}
+
+std::size_t CompressRle(const uint8_t* data, std::size_t numOfData, uint8_t* buffer)
+{
+    const std::size_t maxRun = 0x7F + COMPRESSION_RLE_MIN;
+    uint8_t* const start = buffer;
+
+    std::size_t literalStart = 0;
+    std::size_t i = 0;
+    while (i < numOfData)
+    {
+        std::size_t run = 1;
+        while (i+run < numOfData && run < maxRun && data[i+run] == data[i])
+        {
+            ++run;
+        }
+
+        if (run < COMPRESSION_RLE_MIN)
+        {
+            ++i;
+            continue;
+        }
+
+        buffer = WriteLiterals(data+literalStart, i-literalStart, buffer);
+        *buffer++ = static_cast<uint8_t>(0x80 | (run-COMPRESSION_RLE_MIN));
+        *buffer++ = data[i];
+        i += run;
+        literalStart = i;
+    }
+    buffer = WriteLiterals(data+literalStart, numOfData-literalStart, buffer);
+
+    return buffer - start;
+}
+
+//Greedy matching, with the last position of every 4 bytes hash
+std::size_t CompressLz(const uint8_t* data, std::size_t numOfData, uint8_t* buffer)
+{
+    const std::size_t maxMatch = 0x7F + COMPRESSION_LZ_MIN;
+    uint8_t* const start = buffer;
+
+    uint32_t lastPositions[1<<COMPRESSION_LZ_HASH_BITS];
+    std::fill(lastPositions, lastPositions + (1<<COMPRESSION_LZ_HASH_BITS), gNoPosition);
+
+    std::size_t literalStart = 0;
+    std::size_t i = 0;
+    while (i+COMPRESSION_LZ_MIN <= numOfData)
+    {
+        uint32_t& lastPosition = lastPositions[GetLzHash(data+i)];
+        const uint32_t candidate = lastPosition;
+        lastPosition = i;
+
+        std::size_t length = 0;
+        if (candidate != gNoPosition && i-candidate <= COMPRESSION_LZ_MAX_DISTANCE)
+        {
+            const std::size_t maxLength = std::min(maxMatch, numOfData-i);
+            while (length < maxLength && data[candidate+length] == data[i+length])
+            {
+                ++length;
+            }
+        }
+
+        if (length < COMPRESSION_LZ_MIN)
+        {
+            ++i;
+            continue;
+        }
+
+        const std::size_t distance = i-candidate;
+        buffer = WriteLiterals(data+literalStart, i-literalStart, buffer);
+        *buffer++ = static_cast<uint8_t>(0x80 | (length-COMPRESSION_LZ_MIN));
+        *buffer++ = static_cast<uint8_t>(distance>>8);
+        *buffer++ = static_cast<uint8_t>(distance);
+
+        //The copied positions can be the start of the next matches
+        for (std::size_t j=i+1; j<i+length && j+COMPRESSION_LZ_MIN<=numOfData; ++j)
+        {
+            lastPositions[GetLzHash(data+j)] = j;
+        }
+        i += length;
+        literalStart = i;
+    }
+    buffer = WriteLiterals(data+literalStart, numOfData-literalStart, buffer);
+
+    return buffer - start;
+}
+
+} // namespace
+
+const char* GetCompressionName(uint8_t compression)
+{
+    return (compression < COMP_COUNT) ? gCompressionNames[compression] : "unknown";
+}
+bool GetCompressionFromName(const std::string& name, uint8_t& compression)
+{
+    for (uint8_t i=0; i<COMP_COUNT; ++i)
+    {
+        if (name == gCompressionNames[i])
+        {
+            compression = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::size_t GetCompressedMaxSize(std::size_t numOfData)
+{
+    //Every token is at most as large as its data, plus the literal control bytes
+    return numOfData + (numOfData + COMPRESSION_MAX_LITERALS-1)/COMPRESSION_MAX_LITERALS;
+}
+
+std::size_t CompressData(uint8_t compression, const uint8_t* data, std::size_t numOfData, uint8_t* buffer)
+{
+    switch (compression)
+    {
+    case COMP_RLE:
+        return CompressRle(data, numOfData, buffer);
+    case COMP_LZ:
+        return CompressLz(data, numOfData, buffer);
+    default:
+        std::memcpy(buffer, data, numOfData);
+        return numOfData;
+    }
+}
+
+bool DecompressData(uint8_t compression, const uint8_t* data, std::size_t size, uint8_t* buffer, std::size_t numOfData)
+{
+    if (compression == COMP_NONE)
+    {
+        if (size != numOfData)
+        {
+            return false;
+        }
+        std::memcpy(buffer, data, numOfData);
+        return true;
+    }
+    if (compression >= COMP_COUNT)
+    {
+        return false;
+    }
+
+    std::size_t pos = 0;
+    std::size_t expanded = 0;
+    while (pos < size)
+    {
+        const uint8_t control = data[pos++];
+
+        if (control < 0x80)
+        {
+            const std::size_t count = control+1;
+            if (pos+count > size || expanded+count > numOfData)
+            {
+                return false;
+            }
+            std::memcpy(buffer+expanded, data+pos, count);
+            pos += count;
+            expanded += count;
+        }
+        else if (compression == COMP_RLE)
+        {
+            const std::size_t count = (control&0x7F) + COMPRESSION_RLE_MIN;
+            if (pos+1 > size || expanded+count > numOfData)
+            {
+                return false;
+            }
+            std::fill(buffer+expanded, buffer+expanded+count, data[pos++]);
+            expanded += count;
+        }
+        else
+        {
+            const std::size_t count = (control&0x7F) + COMPRESSION_LZ_MIN;
+            if (pos+2 > size || expanded+count > numOfData)
+            {
+                return false;
+            }
+            const std::size_t distance = (static_cast<std::size_t>(data[pos])<<8) | data[pos+1];
+            pos += 2;
+            if (distance == 0 || distance > expanded)
+            {
+                return false;
+            }
+            //Byte by byte, the copy can overlap itself
+            for (std::size_t i=0; i<count; ++i, ++expanded)
+            {
+                buffer[expanded] = buffer[expanded-distance];
+            }
+        }
+    }
+
+    return expanded == numOfData;
+}
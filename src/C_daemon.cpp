@@ -0,0 +1,771 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+#include "C_daemon.hpp"
+
+#ifndef _WIN32
+
+#include "C_options.hpp"
+#include "C_image.hpp"
+#include "C_log.hpp"
+
+#include <map>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <streambuf>
+#include <sstream>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+    #define MSG_NOSIGNAL 0
+#endif
+
+#define DAEMON_MAX_LINESIZE 65536
+
+namespace
+{
+
+bool SendAll(int fd, const char* data, std::size_t size)
+{
+    while (size > 0)
+    {
+        const ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent <= 0)
+        {
+            return false;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+bool SendAll(int fd, const std::string& data)
+{
+    return SendAll(fd, data.data(), data.size());
+}
+
+bool SetAddress(const std::string& socketPath, sockaddr_un& address)
+{
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size()+1);
+    return true;
+}
+
+//Buffered reads of a socket, by line or by size, all of them within the timeout (ms, 0 for none)
+class SocketReader
+{
+public:
+    explicit SocketReader(int fd, uint32_t timeout = 0) :
+        _g_fd(fd),
+        _g_timeout(timeout),
+        _g_deadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout))
+    {
+    }
+
+    bool readLine(std::string& line)
+    {
+        std::string::size_type end;
+        while ( (end = this->_g_buffer.find('\n')) == std::string::npos )
+        {
+            if (this->_g_buffer.size() > DAEMON_MAX_LINESIZE || !this->fill())
+            {
+                return false;
+            }
+        }
+        line.assign(this->_g_buffer, 0, end);
+        this->_g_buffer.erase(0, end+1);
+        return true;
+    }
+    bool readData(uint8_t* data, std::size_t size)
+    {
+        while (size > 0)
+        {
+            if ( this->_g_buffer.empty() && !this->fill() )
+            {
+                return false;
+            }
+            const std::size_t count = std::min(size, this->_g_buffer.size());
+            std::memcpy(data, this->_g_buffer.data(), count);
+            this->_g_buffer.erase(0, count);
+            data += count;
+            size -= count;
+        }
+        return true;
+    }
+    bool expired() const
+    {
+        return this->_g_timeout != 0 && std::chrono::steady_clock::now() >= this->_g_deadline;
+    }
+
+private:
+    bool fill()
+    {
+        char buffer[4096];
+        ssize_t size;
+        do
+        {
+            if (this->_g_timeout != 0)
+            {
+                //A client sending a few bytes at a time can't hold the reader past the deadline
+                const auto timeLeft = std::chrono::duration_cast<std::chrono::milliseconds>(this->_g_deadline - std::chrono::steady_clock::now()).count();
+                pollfd pollFd{this->_g_fd, POLLIN, 0};
+                if ( timeLeft <= 0 || poll(&pollFd, 1, static_cast<int>(timeLeft)) == 0 )
+                {
+                    return false;
+                }
+            }
+            size = recv(this->_g_fd, buffer, sizeof(buffer), 0);
+        }
+        while (size < 0 && errno == EINTR);
+
+        if (size <= 0)
+        {
+            return false;
+        }
+        this->_g_buffer.append(buffer, size);
+        return true;
+    }
+
+    int _g_fd;
+    uint32_t _g_timeout;
+    std::chrono::steady_clock::time_point _g_deadline;
+    std::string _g_buffer;
+};
+
+//Send the complete lines of a job log to the client, the lines are dropped once the client is gone
+class SocketLogBuffer : public std::streambuf
+{
+public:
+    explicit SocketLogBuffer(int fd) :
+        _g_fd(fd),
+        _g_connected(true)
+    {
+    }
+    ~SocketLogBuffer() override
+    {
+        if ( !this->_g_line.empty() )
+        {
+            this->writeLine();
+        }
+    }
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        if ( traits_type::eq_int_type(c, traits_type::eof()) )
+        {
+            return traits_type::not_eof(c);
+        }
+
+        if (traits_type::to_char_type(c) == '\n')
+        {
+            this->writeLine();
+        }
+        else
+        {
+            this->_g_line += traits_type::to_char_type(c);
+        }
+        return c;
+    }
+    std::streamsize xsputn(const char* s, std::streamsize count) override
+    {
+        for (std::streamsize i=0; i<count; ++i)
+        {
+            this->overflow(traits_type::to_int_type(s[i]));
+        }
+        return count;
+    }
+
+private:
+    void writeLine()
+    {
+        if (this->_g_connected)
+        {
+            this->_g_connected = SendAll(this->_g_fd, "LOG " + this->_g_line + '\n');
+        }
+        this->_g_line.clear();
+    }
+
+    int _g_fd;
+    bool _g_connected;
+    std::string _g_line;
+};
+
+struct DaemonJob
+{
+    int clientFd = -1;
+    std::string portName;
+    TransferSettings settings;
+    bool printStats = false;
+    std::vector<uint8_t> fileData;
+
+    bool dump = false;
+    uint32_t dumpLength = 0;
+};
+
+void EndJob(int clientFd, int result)
+{
+    SendAll(clientFd, "RESULT " + std::to_string(result) + '\n');
+    close(clientFd);
+}
+void RejectJob(int clientFd, const std::string& error)
+{
+    {
+        SocketLogBuffer logBuffer(clientFd);
+        std::ostream log(&logBuffer);
+        log << error;
+    }
+    EndJob(clientFd, -1);
+}
+
+/*
+ One thread per port, the port and the board session are kept between the jobs.
+*/
+class PortWorker
+{
+public:
+    PortWorker(const std::string& portName, const TransferSettings& sessionSettings, std::ostream& log, std::mutex& logMutex) :
+        _g_portName(portName),
+        _g_sessionSettings(sessionSettings),
+        _g_logBuffer(log, logMutex, "[" + portName + "] "),
+        _g_log(&this->_g_logBuffer),
+        _g_sessionOpened(false),
+        _g_jobCount(0),
+        _g_stopping(false)
+    {
+        this->_g_thread = std::thread(&PortWorker::run, this);
+    }
+    ~PortWorker()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->_g_mutex);
+            this->_g_stopping = true;
+        }
+        this->_g_jobReady.notify_all();
+        this->_g_thread.join();
+    }
+
+    PortWorker(const PortWorker&) = delete;
+    PortWorker& operator=(const PortWorker&) = delete;
+
+    void push(DaemonJob&& job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->_g_mutex);
+            this->_g_jobs.push_back(std::move(job));
+        }
+        this->_g_jobReady.notify_one();
+    }
+
+private:
+    void run()
+    {
+        //The handshake is done before the first job
+        this->prepareSession(this->_g_log);
+
+        while (true)
+        {
+            DaemonJob job;
+            {
+                std::unique_lock<std::mutex> lock(this->_g_mutex);
+                this->_g_jobReady.wait(lock, [this](){ return !this->_g_jobs.empty() || this->_g_stopping; });
+                if (this->_g_stopping)
+                {
+                    break;
+                }
+                job = std::move(this->_g_jobs.front());
+                this->_g_jobs.pop_front();
+            }
+            this->execute(job);
+        }
+
+        for (DaemonJob& job : this->_g_jobs)
+        {
+            RejectJob(job.clientFd, "The daemon is stopping !\n");
+        }
+    }
+
+    bool prepareSession(std::ostream& log)
+    {
+        if (this->_g_sessionOpened)
+        {
+            try
+            {
+                //Also drops the replies left by a failed job
+                if ( Resync(*this->_g_port) )
+                {
+                    return true;
+                }
+            }
+            catch (std::exception&)
+            {
+            }
+            log << "The board doesn't answer anymore, opening the session again ..." << std::endl;
+            this->_g_sessionOpened = false;
+        }
+
+        //The board is back at the default baudrate after a reset
+        this->_g_port.reset();
+        try
+        {
+            this->_g_port = OpenTransport(this->_g_portName, log);
+            if (!this->_g_port)
+            {
+                return false;
+            }
+
+            this->_g_sessionOpened = OpenSession(*this->_g_port, this->_g_sessionSettings, this->_g_session, log);
+        }
+        catch (std::exception& e)
+        {
+            log << "Serial error on the port \""<< this->_g_portName <<"\" !" << std::endl;
+            log << e.what() << std::endl;
+            this->_g_port.reset();
+            return false;
+        }
+
+        if (this->_g_sessionOpened)
+        {
+            log << "Session opened" << std::endl;
+        }
+        return this->_g_sessionOpened;
+    }
+
+    void execute(DaemonJob& job)
+    {
+        const StatsClock::time_point start = StatsClock::now();
+
+        TransferStats stats;
+        stats.port = this->_g_portName;
+        {
+            SocketLogBuffer logBuffer(job.clientFd);
+            std::ostream log(&logBuffer);
+
+            if ( this->prepareSession(log) )
+            {
+                try
+                {
+                    if ( job.settings.memoryModel == this->_g_session.memoryModel ||
+                         SelectMemoryModel(*this->_g_port, job.settings.memoryModel, this->_g_session, log, &stats) )
+                    {
+                        if (job.dump)
+                        {
+                            stats.result = DumpMemory(*this->_g_port, job.settings.startAddress, job.dumpLength, job.fileData, job.settings, this->_g_session, log, &stats);
+                        }
+                        else
+                        {
+                            stats.result = TransferFile(*this->_g_port, job.fileData, job.settings, this->_g_session, log, &stats);
+                        }
+                    }
+                }
+                catch (std::exception& e)
+                {
+                    log << "Serial error on the port \""<< this->_g_portName <<"\" !" << std::endl;
+                    log << e.what() << std::endl;
+                    this->_g_sessionOpened = false;
+                }
+            }
+            stats.totalTime = std::chrono::duration_cast<std::chrono::microseconds>(StatsClock::now() - start).count();
+
+            if (job.printStats)
+            {
+                log << std::endl;
+                PrintStats(stats, log);
+            }
+        }
+        if (job.dump && stats.result == 0)
+        {
+            SendAll(job.clientFd, "DUMP " + std::to_string(this->_g_session.geometry.sectorSize) + ' ' + std::to_string(job.fileData.size()) + '\n');
+            SendAll(job.clientFd, reinterpret_cast<const char*>(job.fileData.data()), job.fileData.size());
+        }
+        EndJob(job.clientFd, stats.result);
+
+        this->_g_log << "Job " << ++this->_g_jobCount << " : " << (stats.result == 0 ? "OK" : "FAILED")
+                     << " in " << stats.totalTime/1000 << " ms" << std::endl;
+    }
+
+    std::string _g_portName;
+    TransferSettings _g_sessionSettings;
+
+    PrefixedLogBuffer _g_logBuffer;
+    std::ostream _g_log;
+
+    std::unique_ptr<Transport> _g_port;
+    BoardSession _g_session;
+    bool _g_sessionOpened;
+    uint32_t _g_jobCount;
+
+    std::deque<DaemonJob> _g_jobs;
+    bool _g_stopping;
+
+    std::mutex _g_mutex;
+    std::condition_variable _g_jobReady;
+
+    std::thread _g_thread;
+};
+
+bool ReceiveJob(int clientFd, const DaemonSettings& settings, DaemonJob& job, std::string& error)
+{
+    SocketReader reader(clientFd, DAEMON_RECEIVE_TIMEOUT);
+    std::ostringstream optionLog;
+    std::string line;
+
+    const std::string timeoutError = "The job was not received within " + std::to_string(DAEMON_RECEIVE_TIMEOUT) + " ms !\n";
+
+    if ( !reader.readLine(line) || line != DAEMON_JOB_HEADER )
+    {
+        error = reader.expired() ? timeoutError : "Bad job header !\n";
+        return false;
+    }
+
+    job.settings = settings.settings;
+    while (true)
+    {
+        if ( !reader.readLine(line) )
+        {
+            error = reader.expired() ? timeoutError : "Incomplete job !\n";
+            return false;
+        }
+
+        if (line.compare(0, 5, "DATA ") == 0)
+        {
+            uint32_t size;
+            try
+            {
+                size = std::stoul(line.substr(5));
+            }
+            catch (std::exception&)
+            {
+                error = "Bad job data size !\n";
+                return false;
+            }
+            if (job.dump ? size != 0 : (size == 0 || size > DAEMON_MAX_DATASIZE))
+            {
+                error = job.dump ? "A dump job has no data !\n" :
+                                   "The job data size must be between 1 and " + std::to_string(DAEMON_MAX_DATASIZE) + " !\n";
+                return false;
+            }
+
+            job.fileData.resize(size);
+            if ( !reader.readData(job.fileData.data(), size) )
+            {
+                error = reader.expired() ? timeoutError : "Incomplete job data !\n";
+                return false;
+            }
+
+            //A segmented image comes without its holes
+            if ( !job.dump && !job.settings.segments.empty() )
+            {
+                std::vector<uint8_t> packedData;
+                packedData.swap(job.fileData);
+                if ( !UnpackSegments(packedData, job.settings.segments, job.fileData) )
+                {
+                    error = "The job data doesn't match its segments !\n";
+                    return false;
+                }
+            }
+            break;
+        }
+
+        if (line == "--stats")
+        {
+            job.printStats = true;
+            continue;
+        }
+        if (line.compare(0, 7, "--port=") == 0)
+        {
+            job.portName = line.substr(7);
+            continue;
+        }
+        if (line == "--dump")
+        {
+            job.dump = true;
+            continue;
+        }
+        if (line.compare(0, 9, "--length=") == 0)
+        {
+            uint64_t dumpLength;
+            try
+            {
+                dumpLength = std::stoull(line.substr(9));
+            }
+            catch (std::exception&)
+            {
+                error = "Bad dump length !\n";
+                return false;
+            }
+            if (dumpLength > MAX_IMAGE_SIZE)
+            {
+                error = "Bad dump length !\n";
+                return false;
+            }
+            job.dumpLength = static_cast<uint32_t>(dumpLength);
+            continue;
+        }
+
+        switch ( ParseTransferOption(line, job.settings, optionLog) )
+        {
+        case OPTION_PARSED:
+            continue;
+        case OPTION_ERROR:
+            error = optionLog.str();
+            return false;
+        default:
+            error = "Unknown job option : \"" + line + "\" !\n";
+            return false;
+        }
+    }
+
+    //The session is opened once with the daemon options
+    const TransferSettings& sessionSettings = settings.settings;
+    if ( job.settings.targetBaudrate != sessionSettings.targetBaudrate ||
+         job.settings.hardwareFlowControl != sessionSettings.hardwareFlowControl ||
+         job.settings.autoEncoding != sessionSettings.autoEncoding || job.settings.encoding != sessionSettings.encoding ||
+         job.settings.autoChecksum != sessionSettings.autoChecksum || job.settings.checksumType != sessionSettings.checksumType )
+    {
+        error = "The baudrate, flow control, encoding and checksum are options of the daemon !\n";
+        return false;
+    }
+    if ( !CheckTransferSettings(job.settings, optionLog) )
+    {
+        error = optionLog.str();
+        return false;
+    }
+    if (job.dump && (job.dumpLength == 0 || job.dumpLength > DAEMON_MAX_DATASIZE))
+    {
+        error = "The dump length must be between 1 and " + std::to_string(DAEMON_MAX_DATASIZE) + " !\n";
+        return false;
+    }
+    if (job.dump && static_cast<uint64_t>(job.settings.startAddress) + job.dumpLength > MAX_IMAGE_SIZE)
+    {
+        error = "The dump range must end before the last address of the frames (" + std::to_string(MAX_IMAGE_SIZE-1) + ") !\n";
+        return false;
+    }
+    if (!job.dump && job.settings.startAddress >= job.fileData.size())
+    {
+        error = "Can't start at address " + std::to_string(job.settings.startAddress) + ", the file size is only " + std::to_string(job.fileData.size()) + " bytes !\n";
+        return false;
+    }
+
+    if ( job.portName.empty() )
+    {
+        if (settings.portNames.size() != 1)
+        {
+            error = "The daemon has many ports, the port must be given !\n";
+            return false;
+        }
+        job.portName = settings.portNames.front();
+    }
+    return true;
+}
+
+} // namespace
+
+int RunDaemon(const DaemonSettings& settings, const std::atomic<bool>& running, std::ostream& log)
+{
+    sockaddr_un address;
+    if ( !SetAddress(settings.socketPath, address) )
+    {
+        log << "Bad socket path \"" << settings.socketPath << "\" !" << std::endl;
+        return -1;
+    }
+
+    //A socket left by a previous daemon is replaced, any other file is kept
+    struct stat fileStatus;
+    if ( stat(address.sun_path, &fileStatus) == 0 && S_ISSOCK(fileStatus.st_mode) )
+    {
+        unlink(address.sun_path);
+    }
+
+    const int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    //The socket file is created with its final mode, a chmod after the bind would leave it opened to the others meanwhile
+    const mode_t previousMask = umask(0777 & ~DAEMON_SOCKET_MODE);
+    const bool bound = listenFd >= 0 && bind(listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    umask(previousMask);
+
+    if ( !bound || listen(listenFd, SOMAXCONN) != 0 )
+    {
+        log << "Can't listen on the socket \"" << settings.socketPath << "\" : " << std::strerror(errno) << std::endl;
+        if (listenFd >= 0)
+        {
+            close(listenFd);
+        }
+        return -1;
+    }
+
+    std::mutex logMutex;
+    PrefixedLogBuffer daemonLogBuffer(log, logMutex, "");
+    std::ostream daemonLog(&daemonLogBuffer);
+
+    daemonLog << "Waiting for jobs on \"" << settings.socketPath << "\"" << std::endl;
+
+    {
+        std::map<std::string, std::unique_ptr<PortWorker> > workers;
+        for (const std::string& portName : settings.portNames)
+        {
+            workers[portName].reset(new PortWorker(portName, settings.settings, log, logMutex));
+        }
+
+        while (running)
+        {
+            pollfd pollFd{listenFd, POLLIN, 0};
+            if (poll(&pollFd, 1, DAEMON_POLL_INTERVAL) <= 0)
+            {
+                continue;
+            }
+
+            const int clientFd = accept(listenFd, nullptr, nullptr);
+            if (clientFd < 0)
+            {
+                continue;
+            }
+
+            DaemonJob job;
+            std::string error;
+            if ( !ReceiveJob(clientFd, settings, job, error) )
+            {
+                daemonLog << "Job rejected : " << error << std::flush;
+                RejectJob(clientFd, error);
+                continue;
+            }
+
+            auto it = workers.find(job.portName);
+            if (it == workers.end())
+            {
+                error = "The daemon doesn't have the port \"" + job.portName + "\" !\n";
+                daemonLog << "Job rejected : " << error << std::flush;
+                RejectJob(clientFd, error);
+                continue;
+            }
+
+            job.clientFd = clientFd;
+            it->second->push(std::move(job));
+        }
+    }
+
+    close(listenFd);
+    unlink(address.sun_path);
+
+    daemonLog << "Daemon stopped" << std::endl;
+    return 0;
+}
+
+int SendDaemonJob(const std::string& socketPath, const std::vector<std::string>& options, const std::vector<uint8_t>& fileData, std::ostream& log, DaemonDump* dump)
+{
+    sockaddr_un address;
+    if ( !SetAddress(socketPath, address) )
+    {
+        log << "Bad socket path \"" << socketPath << "\" !" << std::endl;
+        return -1;
+    }
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ( fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 )
+    {
+        log << "Can't connect to the daemon on \"" << socketPath << "\" : " << std::strerror(errno) << std::endl;
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+
+    std::string header = DAEMON_JOB_HEADER "\n";
+    for (const std::string& option : options)
+    {
+        header += option + '\n';
+    }
+    header += "DATA " + std::to_string(fileData.size()) + '\n';
+
+    if ( !SendAll(fd, header) || !SendAll(fd, reinterpret_cast<const char*>(fileData.data()), fileData.size()) )
+    {
+        log << "Can't send the job to the daemon !" << std::endl;
+        close(fd);
+        return -1;
+    }
+
+    //The log is received until the result, the job may wait behind the other jobs of the port
+    SocketReader reader(fd);
+    std::string line;
+    while ( reader.readLine(line) )
+    {
+        if (line.compare(0, 4, "LOG ") == 0)
+        {
+            log << line.substr(4) << std::endl;
+            continue;
+        }
+        if (line.compare(0, 5, "DUMP ") == 0)
+        {
+            DaemonDump received;
+            uint32_t size = 0;
+            std::istringstream header(line.substr(5));
+            if ( !(header >> received.sectorSize >> size) || size > DAEMON_MAX_DATASIZE )
+            {
+                log << "The daemon sent a bad dump !" << std::endl;
+                break;
+            }
+
+            received.data.resize(size);
+            if ( !reader.readData(received.data.data(), size) )
+            {
+                break;
+            }
+            if (dump != nullptr)
+            {
+                *dump = std::move(received);
+            }
+            continue;
+        }
+        if (line.compare(0, 7, "RESULT ") == 0)
+        {
+            close(fd);
+            try
+            {
+                return std::stoi(line.substr(7));
+            }
+            catch (std::exception&)
+            {
+                return -1;
+            }
+        }
+    }
+
+    log << "The daemon closed the connection without a result !" << std::endl;
+    close(fd);
+    return -1;
+}
+
+#endif //_WIN32
@@ -0,0 +1,544 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "C_emulator.hpp"
+#include "C_transfer.hpp"
+#include "C_encoding.hpp"
+#include "C_checksum.hpp"
+#include "C_compression.hpp"
+#include "C_string.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <termios.h>
+    #include <unistd.h>
+    #include <cstdlib>
+#endif //_WIN32
+
+Emulator::Emulator(const EmulatorSettings& settings) :
+    _g_settings(settings),
+    _g_eeprom(settings.eepromSize, DEFAULT_ERASED_VALUE),
+    _g_flash(settings.flashSize, DEFAULT_ERASED_VALUE),
+    _g_writeData(settings.maxPayload),
+    _g_compressedData(GetCompressedMaxSize(settings.maxPayload)),
+    _g_dataCommands(0),
+    _g_memoryModel(MEMM_EEPROM),
+    _g_encoding(ENC_DECIMAL),
+    _g_checksumType(CHECKSUM_SUM8),
+    _g_baudrate(settings.baudrate)
+{
+}
+
+std::string Emulator::execute(const std::string& frame, uint32_t& processingTime)
+{
+    processingTime = this->_g_settings.commandDelay;
+
+    if ( frame.size() < 3 || frame.front() != '$' || frame.back() != '#' )
+    {
+        return "UNKNOWN\n";
+    }
+
+    if (frame[1] == 'W' || frame[1] == 'P' || frame[1] == 'Z' || frame[1] == 'Y' || frame[1] == 'R')
+    {
+        ++this->_g_dataCommands;
+        if (this->_g_settings.dropInterval != 0 && this->_g_dataCommands % this->_g_settings.dropInterval == 0)
+        {
+            return std::string();
+        }
+    }
+
+    switch (frame[1])
+    {
+    case 'H':
+        return "HELLO\n";
+    case 'I':
+        return this->_g_settings.information + '\n';
+    case 'M':
+        if ( frame.size() != 4 || (frame[2] != '0' && frame[2] != '1') )
+        {
+            return "UNKNOWN\n";
+        }
+        this->_g_memoryModel = frame[2]-'0';
+        return std::string(1, frame[2]) + '\n';
+    case 'E':
+        if ( frame.size() != 4 || frame[2] < '0' || frame[2] >= '0'+ENC_COUNT )
+        {
+            return "UNKNOWN\n";
+        }
+        this->_g_encoding = frame[2]-'0';
+        return std::string(1, frame[2]) + '\n';
+    case 'S':
+        if ( frame.size() != 4 || frame[2] < '0' || frame[2] >= '0'+CHECKSUM_COUNT )
+        {
+            return "UNKNOWN\n";
+        }
+        this->_g_checksumType = frame[2]-'0';
+        return std::string(1, frame[2]) + '\n';
+    case 'B':
+    {
+        uint32_t baudrate;
+        if ( frame.size() != 12 || !GetUint24FromString(frame, 2, baudrate) || baudrate == 0 )
+        {
+            return "UNKNOWN\n";
+        }
+        //The reply is sent with the previous baudrate, the runner read it back after the command
+        if (this->_g_baudrate != 0)
+        {
+            this->_g_baudrate = baudrate;
+        }
+        return frame.substr(1, 9) + '\n';
+    }
+    case 'F':
+        return this->executeErase(frame, processingTime);
+    case 'W':
+        return this->executeWrite(frame, false, false, processingTime);
+    case 'P':
+        return this->executeWrite(frame, true, false, processingTime);
+    case 'Z':
+        return this->executeWrite(frame, false, true, processingTime);
+    case 'Y':
+        return this->executeWrite(frame, true, true, processingTime);
+    case 'R':
+        return this->executeRead(frame);
+    case 'K':
+        return this->executeBlankCheck(frame);
+    case 'C':
+        return this->executeRangeCrc(frame, processingTime);
+    default:
+        return "UNKNOWN\n";
+    }
+}
+
+std::string Emulator::getCommandName(const std::string& frame)
+{
+    if (frame.size() < 2)
+    {
+        return std::string();
+    }
+    if (frame.compare(1, 3, "FES") == 0)
+    {
+        return "FES";
+    }
+    return frame.substr(1, 1);
+}
+
+const EmulatorSettings& Emulator::getSettings() const
+{
+    return this->_g_settings;
+}
+uint32_t Emulator::getBaudrate() const
+{
+    return this->_g_baudrate;
+}
+const std::vector<uint8_t>& Emulator::getMemory(uint8_t memoryModel) const
+{
+    return memoryModel == MEMM_FLASH ? this->_g_flash : this->_g_eeprom;
+}
+
+std::string Emulator::executeWrite(const std::string& frame, bool sequenced, bool compressed, uint32_t& processingTime)
+{
+    std::size_t pos = 2;
+    const std::size_t endPos = frame.size()-1;
+
+    uint8_t sequence = 0;
+    if (sequenced)
+    {
+        if ( !GetUint8FromString(frame, pos, sequence) )
+        {
+            return "UNKNOWN\n";
+        }
+        pos += 3;
+    }
+
+    uint8_t compression = COMP_NONE;
+    if (compressed)
+    {
+        if ( pos >= endPos || frame[pos] < '0'+COMP_RLE || frame[pos] >= '0'+COMP_COUNT )
+        {
+            return "UNKNOWN\n";
+        }
+        compression = frame[pos++]-'0';
+    }
+
+    const uint8_t checksumSize = GetChecksumSize(this->_g_checksumType);
+    uint8_t checksum[MAX_CHECKSUM_SIZE];
+    for (uint8_t i=0; i<checksumSize; ++i)
+    {
+        if ( DecodeUint8(frame, pos, this->_g_encoding, checksum[i]) != DECODE_OK )
+        {
+            return "UNKNOWN\n";
+        }
+    }
+
+    uint32_t address;
+    if ( !GetUint24FromString(frame, pos, address) )
+    {
+        return "UNKNOWN\n";
+    }
+    pos += 8;
+
+    uint32_t expandedSize = 0;
+    if (compressed)
+    {
+        if ( !GetUint24FromString(frame, pos, expandedSize) || expandedSize > this->_g_writeData.size() )
+        {
+            return "UNKNOWN\n";
+        }
+        pos += 8;
+    }
+
+    //The compressed data is expanded in the page buffer
+    std::vector<uint8_t>& receivedData = compressed ? this->_g_compressedData : this->_g_writeData;
+    uint32_t numOfData = 0;
+    while (pos < endPos)
+    {
+        if ( numOfData >= receivedData.size() || DecodeUint8(frame, pos, this->_g_encoding, receivedData[numOfData]) != DECODE_OK || pos > endPos )
+        {
+            return "UNKNOWN\n";
+        }
+        ++numOfData;
+    }
+
+    uint8_t* data = this->_g_writeData.data();
+    if (compressed)
+    {
+        if ( !DecompressData(compression, receivedData.data(), numOfData, data, expandedSize) )
+        {
+            return "BADSUM\n";
+        }
+        numOfData = expandedSize;
+    }
+
+    uint8_t dataChecksum[MAX_CHECKSUM_SIZE];
+    GetChecksumBytes(data, numOfData, this->_g_checksumType, dataChecksum);
+    if ( numOfData == 0 || !std::equal(checksum, checksum+checksumSize, dataChecksum) )
+    {
+        return "BADSUM\n";
+    }
+
+    std::vector<uint8_t>& memory = this->_g_memoryModel == MEMM_FLASH ? this->_g_flash : this->_g_eeprom;
+    if ( address + numOfData > memory.size() )
+    {
+        return "BADADDRESS\n";
+    }
+
+    if (this->_g_memoryModel == MEMM_FLASH)
+    {
+        //A flash write can only clear bits
+        for (uint32_t i=0; i<numOfData; ++i)
+        {
+            memory[address+i] &= data[i];
+        }
+        processingTime += numOfData * this->_g_settings.flashWriteTime;
+    }
+    else
+    {
+        std::copy(data, data+numOfData, memory.begin()+address);
+
+        const uint32_t pageSize = std::max<uint32_t>(1, this->_g_settings.eepromPageSize);
+        const uint32_t numOfPages = (address+numOfData-1)/pageSize - address/pageSize + 1;
+        processingTime += numOfPages * this->_g_settings.eepromWriteTime;
+    }
+
+    std::string reply = "WRITED";
+    if (sequenced)
+    {
+        PushUint8InString(sequence, reply);
+    }
+    return reply + '\n';
+}
+std::string Emulator::executeRead(const std::string& frame)
+{
+    uint32_t address;
+    uint32_t numOfData;
+    if ( frame.size() != 19 || !GetUint24FromString(frame, 2, address) || !GetUint24FromString(frame, 10, numOfData) )
+    {
+        return "UNKNOWN\n";
+    }
+
+    const std::vector<uint8_t>& memory = this->getMemory(this->_g_memoryModel);
+    if ( address + numOfData > memory.size() )
+    {
+        return "BADADDRESS\n";
+    }
+
+    const uint8_t* data = memory.data() + address;
+
+    //The read checksum covers the whole range
+    uint8_t checksum[MAX_CHECKSUM_SIZE];
+    uint8_t checksumSize = GetChecksumBytes(data, numOfData, this->_g_checksumType, checksum);
+
+    std::string reply = "READED";
+    PushEncodedData(checksum, checksumSize, this->_g_encoding, reply);
+    PushUint24InString(address, reply);
+    PushEncodedData(data, numOfData, this->_g_encoding, reply);
+    return reply + '\n';
+}
+std::string Emulator::executeErase(const std::string& frame, uint32_t& processingTime)
+{
+    uint8_t startSector;
+    uint8_t countSector;
+    if ( frame.size() != 11 || frame.compare(1, 3, "FES") != 0 ||
+         !GetUint8FromString(frame, 4, startSector) || !GetUint8FromString(frame, 7, countSector) )
+    {
+        return "UNKNOWN\n";
+    }
+
+    const uint32_t startAddress = static_cast<uint32_t>(startSector) * this->_g_settings.flashSectorSize;
+    const uint32_t endAddress = std::min<uint32_t>((static_cast<uint32_t>(startSector)+countSector) * this->_g_settings.flashSectorSize, this->_g_flash.size());
+    if (startAddress < endAddress)
+    {
+        std::fill(this->_g_flash.begin()+startAddress, this->_g_flash.begin()+endAddress, DEFAULT_ERASED_VALUE);
+    }
+
+    processingTime += countSector * this->_g_settings.flashEraseTime;
+    return "ERASED\n";
+}
+std::string Emulator::executeRangeCrc(const std::string& frame, uint32_t& processingTime)
+{
+    uint32_t address;
+    uint32_t numOfData;
+    if ( frame.size() != 19 || !GetUint24FromString(frame, 2, address) || !GetUint24FromString(frame, 10, numOfData) )
+    {
+        return "UNKNOWN\n";
+    }
+
+    const std::vector<uint8_t>& memory = this->getMemory(this->_g_memoryModel);
+    if ( address + numOfData > memory.size() )
+    {
+        return "BADADDRESS\n";
+    }
+
+    processingTime += static_cast<uint32_t>(static_cast<uint64_t>(numOfData) * this->_g_settings.crcTime / 1000);
+
+    const uint32_t crc = CalculateCrc32(memory.data()+address, numOfData);
+
+    std::string reply = "CRC";
+    PushUint32HexInString(crc, reply);
+    return reply + '\n';
+}
+std::string Emulator::executeBlankCheck(const std::string& frame)
+{
+    uint32_t address;
+    uint32_t numOfData;
+    if ( frame.size() != 19 || !GetUint24FromString(frame, 2, address) || !GetUint24FromString(frame, 10, numOfData) )
+    {
+        return "UNKNOWN\n";
+    }
+
+    const std::vector<uint8_t>& memory = this->getMemory(this->_g_memoryModel);
+    if ( address + numOfData > memory.size() )
+    {
+        return "BADADDRESS\n";
+    }
+
+    for (uint32_t i=0; i<numOfData; ++i)
+    {
+        if (memory[address+i] != DEFAULT_ERASED_VALUE)
+        {
+            std::string reply = "NOTBLANK";
+            PushUint24InString(address+i, reply);
+            return reply + '\n';
+        }
+    }
+    return "BLANK\n";
+}
+
+#ifndef _WIN32
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+struct ScheduledReply
+{
+    Clock::time_point _sent; //Command sent by the host
+    Clock::time_point _due; //Last byte of the reply on the wire
+    std::string _command;
+    std::string _data;
+};
+
+Clock::duration GetWireTime(std::size_t size, uint32_t baudrate)
+{
+    if (baudrate == 0)
+    {
+        return Clock::duration::zero();
+    }
+    //8N1 : 10 bits per byte
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(static_cast<uint64_t>(size) * 10000000000ULL / baudrate));
+}
+uint32_t ToMicroseconds(Clock::duration duration)
+{
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+}
+
+} // namespace
+
+bool OpenPseudoTerminal(int& masterFd, int& slaveFd, std::string& slavePath)
+{
+    masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (masterFd < 0)
+    {
+        return false;
+    }
+    if ( grantpt(masterFd) != 0 || unlockpt(masterFd) != 0 || ptsname(masterFd) == nullptr )
+    {
+        close(masterFd);
+        return false;
+    }
+    slavePath = ptsname(masterFd);
+
+    //The slave is kept open, so the master stay valid between host connections
+    slaveFd = open(slavePath.c_str(), O_RDWR | O_NOCTTY);
+    if (slaveFd < 0)
+    {
+        close(masterFd);
+        return false;
+    }
+
+    termios options;
+    if (tcgetattr(slaveFd, &options) == 0)
+    {
+        cfmakeraw(&options);
+        tcsetattr(slaveFd, TCSANOW, &options);
+    }
+    return true;
+}
+
+void RunEmulator(Emulator& emulator, int masterFd, const std::atomic<bool>& running, EmulatorStats& stats)
+{
+    std::deque<ScheduledReply> replies;
+    std::string frame;
+    bool inFrame = false;
+    Clock::time_point frameSent;
+
+    //Time at which the wire (in both directions) and the board are free again
+    Clock::time_point rxFree = Clock::now();
+    Clock::time_point boardFree = rxFree;
+    Clock::time_point txFree = rxFree;
+    Clock::time_point lastReply;
+    bool waitingHost = false;
+
+    uint8_t buffer[4096];
+
+    while (running)
+    {
+        int timeout = 20;
+        if (!replies.empty())
+        {
+            Clock::duration wait = replies.front()._due - Clock::now();
+            timeout = wait > Clock::duration::zero() ? std::min<int>(20, ToMicroseconds(wait)/1000) : 0;
+        }
+
+        pollfd pollFd{masterFd, POLLIN, 0};
+        int result = poll(&pollFd, 1, timeout);
+
+        if ( result > 0 && (pollFd.revents & POLLIN) )
+        {
+            ssize_t size = read(masterFd, buffer, sizeof(buffer));
+            const Clock::time_point now = Clock::now();
+
+            for (ssize_t i=0; i<size; ++i)
+            {
+                const char c = static_cast<char>(buffer[i]);
+                ++stats.receivedBytes;
+
+                if (!inFrame)
+                {
+                    if (c == '$')
+                    {
+                        inFrame = true;
+                        frame = c;
+                        frameSent = now;
+                        if (waitingHost)
+                        {
+                            stats.turnarounds.push_back(ToMicroseconds(now - lastReply));
+                            waitingHost = false;
+                        }
+                    }
+                    continue;
+                }
+
+                frame += c;
+                if (c != '#')
+                {
+                    continue;
+                }
+                inFrame = false;
+
+                ///Complete command, schedule its reply
+                const uint32_t baudrate = emulator.getBaudrate();
+
+                const Clock::time_point received = std::max(frameSent, rxFree) + GetWireTime(frame.size(), baudrate);
+                rxFree = received;
+
+                uint32_t processingTime = 0;
+                ScheduledReply reply;
+                reply._data = emulator.execute(frame, processingTime);
+                if (reply._data.empty())
+                {
+                    continue;
+                }
+                reply._command = Emulator::getCommandName(frame);
+                reply._sent = frameSent;
+
+                boardFree = std::max(received, boardFree) + std::chrono::microseconds(processingTime);
+                reply._due = std::max(boardFree, txFree) + GetWireTime(reply._data.size(), baudrate);
+                txFree = reply._due;
+
+                replies.push_back(std::move(reply));
+            }
+        }
+        else if ( result < 0 || (result > 0 && (pollFd.revents & (POLLERR | POLLNVAL))) )
+        {
+            break;
+        }
+
+        ///Send the replies that are due
+        const Clock::time_point now = Clock::now();
+        while ( !replies.empty() && replies.front()._due <= now )
+        {
+            const ScheduledReply& reply = replies.front();
+
+            std::size_t written = 0;
+            while (written < reply._data.size())
+            {
+                ssize_t size = write(masterFd, reply._data.data()+written, reply._data.size()-written);
+                if (size <= 0)
+                {
+                    break;
+                }
+                written += size;
+            }
+
+            stats.sentBytes += reply._data.size();
+            ++stats.commands;
+            stats.latencies[reply._command].push_back(ToMicroseconds(now - reply._sent));
+
+            lastReply = now;
+            waitingHost = replies.size() == 1 && !inFrame;
+            replies.pop_front();
+        }
+    }
+}
+
+#endif //_WIN32
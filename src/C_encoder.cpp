@@ -0,0 +1,192 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "C_encoder.hpp"
+#include "C_frame.hpp"
+#include "C_compression.hpp"
+#include "C_encoding.hpp"
+
+#include <algorithm>
+
+ChunkEncoder::ChunkEncoder(const uint8_t* data, const AddressRangeList& ranges, const MemoryGeometry& geometry, uint8_t encoding, uint8_t checksumType,
+                           uint8_t compressions, bool buildWrite, bool sequenced, bool buildRead, std::size_t capacity) :
+    _g_data(data),
+    _g_ranges(ranges),
+    _g_geometry(geometry),
+    _g_encoding(encoding),
+    _g_checksumType(checksumType),
+    _g_compressions(compressions),
+    _g_buildWrite(buildWrite),
+    _g_sequenced(sequenced),
+    _g_buildRead(buildRead),
+    _g_capacity(std::max<std::size_t>(1, capacity)),
+    _g_finished(false),
+    _g_stopping(false)
+{
+    this->_g_thread = std::thread(&ChunkEncoder::run, this);
+}
+ChunkEncoder::~ChunkEncoder()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->_g_mutex);
+        this->_g_stopping = true;
+    }
+    this->_g_chunkTaken.notify_all();
+    this->_g_thread.join();
+}
+
+bool ChunkEncoder::pop(EncodedChunk& chunk)
+{
+    std::unique_lock<std::mutex> lock(this->_g_mutex);
+    this->_g_chunkReady.wait(lock, [this](){ return !this->_g_chunks.empty() || this->_g_finished; });
+
+    if ( this->_g_chunks.empty() )
+    {
+        return false;
+    }
+
+    chunk = std::move(this->_g_chunks.front());
+    this->_g_chunks.pop_front();
+    lock.unlock();
+
+    this->_g_chunkTaken.notify_one();
+    return true;
+}
+
+void ChunkEncoder::recycle(EncodedChunk&& chunk)
+{
+    std::lock_guard<std::mutex> lock(this->_g_mutex);
+    if (this->_g_freeChunks.size() < this->_g_capacity)
+    {
+        this->_g_freeChunks.push_back(std::move(chunk));
+    }
+}
+
+void ChunkEncoder::buildWriteFrame(EncodedChunk& chunk)
+{
+    chunk.compression = COMP_NONE;
+
+    if (this->_g_compressions & ~(1<<COMP_NONE))
+    {
+        const std::size_t maxSize = GetCompressedMaxSize(chunk.numOfData);
+        if (this->_g_compressedData.size() < maxSize)
+        {
+            this->_g_compressedData.resize(maxSize);
+            this->_g_candidateData.resize(maxSize);
+        }
+
+        //The sizes are compared once encoded, the escaped bytes of the binary encoding count
+        std::size_t bestFrameSize = GetEncodedSize(chunk.data, chunk.numOfData, this->_g_encoding);
+        std::size_t compressedSize = 0;
+        for (uint8_t compression=COMP_NONE+1; compression<COMP_COUNT; ++compression)
+        {
+            if ( !(this->_g_compressions & (1<<compression)) )
+            {
+                continue;
+            }
+
+            const std::size_t candidateSize = CompressData(compression, chunk.data, chunk.numOfData, this->_g_candidateData.data());
+            const std::size_t frameSize = FRAME_COMPRESSED_OVERHEAD + GetEncodedSize(this->_g_candidateData.data(), candidateSize, this->_g_encoding);
+            if (frameSize < bestFrameSize)
+            {
+                bestFrameSize = frameSize;
+                compressedSize = candidateSize;
+                chunk.compression = compression;
+                this->_g_compressedData.swap(this->_g_candidateData);
+            }
+        }
+
+        if (chunk.compression != COMP_NONE)
+        {
+            if (this->_g_sequenced)
+            {
+                BuildSequencedCompressedWriteFrame(chunk.sequence, chunk.address, chunk.data, chunk.numOfData, chunk.compression,
+                                                   this->_g_compressedData.data(), compressedSize, this->_g_encoding, this->_g_checksumType, chunk.writeFrame);
+            }
+            else
+            {
+                BuildCompressedWriteFrame(chunk.address, chunk.data, chunk.numOfData, chunk.compression,
+                                          this->_g_compressedData.data(), compressedSize, this->_g_encoding, this->_g_checksumType, chunk.writeFrame);
+            }
+            return;
+        }
+    }
+
+    if (this->_g_sequenced)
+    {
+        BuildSequencedWriteFrame(chunk.sequence, chunk.address, chunk.data, chunk.numOfData, this->_g_encoding, this->_g_checksumType, chunk.writeFrame);
+    }
+    else
+    {
+        BuildWriteFrame(chunk.address, chunk.data, chunk.numOfData, this->_g_encoding, this->_g_checksumType, chunk.writeFrame);
+    }
+}
+
+void ChunkEncoder::run()
+{
+    uint8_t sequence = 0;
+
+    for (const AddressRange& range : this->_g_ranges)
+    {
+        for (uint32_t offset=0, numOfData=0; offset<range.size; offset+=numOfData)
+        {
+            numOfData = GetChunkSize(this->_g_geometry, range.address+offset, range.size-offset);
+
+            EncodedChunk chunk;
+            {
+                std::lock_guard<std::mutex> lock(this->_g_mutex);
+                if ( !this->_g_freeChunks.empty() )
+                {
+                    chunk = std::move(this->_g_freeChunks.back());
+                    this->_g_freeChunks.pop_back();
+                }
+            }
+
+            chunk.sequence = sequence++;
+            chunk.address = range.address + offset;
+            chunk.numOfData = numOfData;
+
+            chunk.data = this->_g_data + chunk.address;
+
+            if (this->_g_buildWrite)
+            {
+                this->buildWriteFrame(chunk);
+            }
+            if (this->_g_buildRead)
+            {
+                BuildReadFrame(chunk.address, chunk.numOfData, chunk.readFrame);
+                chunk.readReplySize = GetReadReplySize(chunk.data, chunk.numOfData, this->_g_encoding, this->_g_checksumType);
+            }
+
+            std::unique_lock<std::mutex> lock(this->_g_mutex);
+            this->_g_chunkTaken.wait(lock, [this](){ return this->_g_chunks.size() < this->_g_capacity || this->_g_stopping; });
+            if (this->_g_stopping)
+            {
+                return;
+            }
+            this->_g_chunks.push_back(std::move(chunk));
+            lock.unlock();
+
+            this->_g_chunkReady.notify_one();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->_g_mutex);
+        this->_g_finished = true;
+    }
+    this->_g_chunkReady.notify_all();
+}
@@ -0,0 +1,299 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "C_encoding.hpp"
+#include "C_string.hpp"
+
+namespace
+{
+
+const char* const gEncodingNames[ENC_COUNT] = {"decimal", "hex", "binary"};
+
+//Hexadecimal digits of every byte value
+struct HexTable
+{
+    constexpr HexTable() :
+        _digits()
+    {
+        const char hexDigits[] = "0123456789ABCDEF";
+        for (unsigned int i=0; i<256; ++i)
+        {
+            this->_digits[i][0] = hexDigits[i>>4];
+            this->_digits[i][1] = hexDigits[i&0x0F];
+        }
+    }
+
+    char _digits[256][2];
+};
+
+constexpr HexTable gHexTable;
+
+bool IsEscaped(uint8_t value)
+{
+    return value == '$' || value == '#' || value == '\n' || value == ENCODING_ESCAPE;
+}
+int GetHexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c-'0';
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c-'A'+10;
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c-'a'+10;
+    }
+    return -1;
+}
+
+} // namespace
+
+const char* GetEncodingName(uint8_t encoding)
+{
+    return (encoding < ENC_COUNT) ? gEncodingNames[encoding] : "unknown";
+}
+bool GetEncodingFromName(const std::string& name, uint8_t& encoding)
+{
+    for (uint8_t i=0; i<ENC_COUNT; ++i)
+    {
+        if (name == gEncodingNames[i])
+        {
+            encoding = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::size_t GetEncodedMinSize(std::size_t numOfData, uint8_t encoding)
+{
+    switch (encoding)
+    {
+    case ENC_HEX:
+        return numOfData*2;
+    case ENC_BINARY:
+        return numOfData;
+    default:
+        return numOfData*3;
+    }
+}
+
+std::size_t GetEncodedMaxSize(std::size_t numOfData, uint8_t encoding)
+{
+    return (encoding == ENC_BINARY) ? numOfData*2 : GetEncodedMinSize(numOfData, encoding);
+}
+std::size_t GetEncodedSize(const uint8_t* data, std::size_t numOfData, uint8_t encoding)
+{
+    std::size_t size = GetEncodedMinSize(numOfData, encoding);
+    if (encoding == ENC_BINARY)
+    {
+        for (std::size_t i=0; i<numOfData; ++i)
+        {
+            size += IsEscaped(data[i]) ? 1 : 0;
+        }
+    }
+    return size;
+}
+
+char* WriteEncodedUint8(uint8_t value, uint8_t encoding, char* buffer)
+{
+    switch (encoding)
+    {
+    case ENC_HEX:
+        buffer[0] = gHexTable._digits[value][0];
+        buffer[1] = gHexTable._digits[value][1];
+        return buffer+2;
+    case ENC_BINARY:
+        if ( IsEscaped(value) )
+        {
+            buffer[0] = static_cast<char>(ENCODING_ESCAPE);
+            buffer[1] = static_cast<char>(value^ENCODING_ESCAPE_XOR);
+            return buffer+2;
+        }
+        buffer[0] = static_cast<char>(value);
+        return buffer+1;
+    default:
+        return WriteUint8InBuffer(value, buffer);
+    }
+}
+char* WriteEncodedData(const uint8_t* data, std::size_t numOfData, uint8_t encoding, char* buffer)
+{
+    switch (encoding)
+    {
+    case ENC_HEX:
+        for (std::size_t i=0; i<numOfData; ++i)
+        {
+            buffer[0] = gHexTable._digits[data[i]][0];
+            buffer[1] = gHexTable._digits[data[i]][1];
+            buffer += 2;
+        }
+        return buffer;
+    case ENC_BINARY:
+        for (std::size_t i=0; i<numOfData; ++i)
+        {
+            buffer = WriteEncodedUint8(data[i], ENC_BINARY, buffer);
+        }
+        return buffer;
+    default:
+        for (std::size_t i=0; i<numOfData; ++i)
+        {
+            buffer = WriteUint8InBuffer(data[i], buffer);
+        }
+        return buffer;
+    }
+}
+
+void PushEncodedUint8(uint8_t value, uint8_t encoding, std::string& str)
+{
+    char buffer[ENCODED_UINT8_MAX_SIZE];
+    str.append(buffer, WriteEncodedUint8(value, encoding, buffer));
+}
+void PushEncodedData(const uint8_t* data, std::size_t numOfData, uint8_t encoding, std::string& str)
+{
+    const std::size_t size = str.size();
+    str.resize(size + GetEncodedMaxSize(numOfData, encoding));
+    char* end = WriteEncodedData(data, numOfData, encoding, &str[size]);
+    str.resize(end - str.data());
+}
+
+bool MatchEncodedData(const std::string& str, std::size_t& pos, const uint8_t* data, std::size_t numOfData, uint8_t encoding)
+{
+    if (pos + GetEncodedMinSize(numOfData, encoding) > str.size())
+    {
+        return false;
+    }
+    const char* buffer = str.data() + pos;
+
+    switch (encoding)
+    {
+    case ENC_HEX:
+        for (std::size_t i=0; i<numOfData; ++i)
+        {
+            const char* digits = gHexTable._digits[data[i]];
+            if (buffer[0] != digits[0] || buffer[1] != digits[1])
+            {
+                return false;
+            }
+            buffer += 2;
+        }
+        break;
+    case ENC_BINARY:
+        {
+            const char* bufferEnd = str.data() + str.size();
+            for (std::size_t i=0; i<numOfData; ++i)
+            {
+                if ( IsEscaped(data[i]) )
+                {
+                    if (bufferEnd-buffer < 2 || static_cast<uint8_t>(buffer[0]) != ENCODING_ESCAPE ||
+                        static_cast<uint8_t>(buffer[1]) != (data[i]^ENCODING_ESCAPE_XOR))
+                    {
+                        return false;
+                    }
+                    buffer += 2;
+                }
+                else
+                {
+                    if (buffer >= bufferEnd || static_cast<uint8_t>(buffer[0]) != data[i])
+                    {
+                        return false;
+                    }
+                    buffer += 1;
+                }
+            }
+        }
+        break;
+    default:
+        for (std::size_t i=0; i<numOfData; ++i)
+        {
+            const char* digits = GetUint8Digits(data[i]);
+            if (buffer[0] != digits[0] || buffer[1] != digits[1] || buffer[2] != digits[2])
+            {
+                return false;
+            }
+            buffer += 3;
+        }
+        break;
+    }
+
+    pos = buffer - str.data();
+    return true;
+}
+
+uint8_t DecodeUint8(const std::string& str, std::size_t& pos, uint8_t encoding, uint8_t& value)
+{
+    switch (encoding)
+    {
+    case ENC_HEX:
+        {
+            if (pos+2 > str.size())
+            {
+                return DECODE_INCOMPLETE;
+            }
+            int high = GetHexValue(str[pos]);
+            int low = GetHexValue(str[pos+1]);
+            if (high < 0 || low < 0)
+            {
+                return DECODE_INVALID;
+            }
+            value = static_cast<uint8_t>((high<<4) | low);
+            pos += 2;
+            return DECODE_OK;
+        }
+    case ENC_BINARY:
+        {
+            if (pos >= str.size())
+            {
+                return DECODE_INCOMPLETE;
+            }
+            uint8_t c = static_cast<uint8_t>(str[pos]);
+            if (c != ENCODING_ESCAPE)
+            {
+                if ( IsEscaped(c) )
+                {
+                    return DECODE_INVALID;
+                }
+                value = c;
+                pos += 1;
+                return DECODE_OK;
+            }
+            if (pos+2 > str.size())
+            {
+                return DECODE_INCOMPLETE;
+            }
+            value = static_cast<uint8_t>(str[pos+1]) ^ ENCODING_ESCAPE_XOR;
+            if ( !IsEscaped(value) )
+            {
+                return DECODE_INVALID;
+            }
+            pos += 2;
+            return DECODE_OK;
+        }
+    default:
+        if (pos+3 > str.size())
+        {
+            return DECODE_INCOMPLETE;
+        }
+        if ( !GetUint8FromString(str, pos, value) )
+        {
+            return DECODE_INVALID;
+        }
+        pos += 3;
+        return DECODE_OK;
+    }
+}
@@ -0,0 +1,222 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "C_frame.hpp"
+#include "C_string.hpp"
+#include "C_checksum.hpp"
+#include "C_encoding.hpp"
+
+namespace
+{
+
+//The frame is sized for the worst case and written in place, so a reused frame doesn't allocate
+char* BeginFrame(std::string& frame, std::size_t maxSize)
+{
+    frame.resize(maxSize);
+    return &frame[0];
+}
+void EndFrame(std::string& frame, const char* end)
+{
+    frame.resize(end - frame.data());
+}
+
+std::size_t GetCompressedFrameMaxSize(std::size_t compressedSize, uint8_t checksumSize, uint8_t encoding)
+{
+    return 3 + UINT8_STRING_SIZE + FRAME_COMPRESSED_OVERHEAD + GetEncodedMaxSize(checksumSize, encoding) + UINT24_STRING_SIZE + GetEncodedMaxSize(compressedSize, encoding);
+}
+char* WriteCompressedPayload(uint32_t address, const uint8_t* data, uint32_t numOfData, uint8_t compression, const uint8_t* compressedData, std::size_t compressedSize,
+                             uint8_t encoding, uint8_t checksumType, char* buffer)
+{
+    uint8_t checksum[MAX_CHECKSUM_SIZE];
+    uint8_t checksumSize = GetChecksumBytes(data, numOfData, checksumType, checksum);
+
+    *buffer++ = compression + '0'; //Push compression
+    buffer = WriteEncodedData(checksum, checksumSize, encoding, buffer); //Push checksum of the expanded data
+    buffer = WriteUint24InBuffer(address, buffer); //Push start address
+    buffer = WriteUint24InBuffer(numOfData, buffer); //Push expanded size
+    buffer = WriteEncodedData(compressedData, compressedSize, encoding, buffer); //Push compressed data
+    *buffer++ = '#';
+    return buffer;
+}
+
+} // namespace
+
+void BuildEncodingFrame(uint8_t encoding, std::string& frame)
+{
+    frame = "$Ex#";
+    frame[2] = encoding + '0';
+}
+void BuildBaudrateFrame(uint32_t baudrate, bool hardwareFlowControl, std::string& frame)
+{
+    char* buffer = BeginFrame(frame, 4 + UINT24_STRING_SIZE);
+    *buffer++ = '$';
+    *buffer++ = 'B';
+    buffer = WriteUint24InBuffer(baudrate, buffer); //Push baudrate
+    *buffer++ = hardwareFlowControl ? '1' : '0';
+    *buffer++ = '#';
+    EndFrame(frame, buffer);
+}
+
+void BuildChecksumFrame(uint8_t checksumType, std::string& frame)
+{
+    frame = "$Sx#";
+    frame[2] = checksumType + '0';
+}
+
+void BuildWriteFrame(uint32_t address, const uint8_t* data, uint32_t numOfData, uint8_t encoding, uint8_t checksumType, std::string& frame)
+{
+    uint8_t checksum[MAX_CHECKSUM_SIZE];
+    uint8_t checksumSize = GetChecksumBytes(data, numOfData, checksumType, checksum);
+
+    char* buffer = BeginFrame(frame, 3 + GetEncodedMaxSize(checksumSize, encoding) + UINT24_STRING_SIZE + GetEncodedMaxSize(numOfData, encoding));
+    *buffer++ = '$';
+    *buffer++ = 'W';
+    buffer = WriteEncodedData(checksum, checksumSize, encoding, buffer); //Push checksum
+    buffer = WriteUint24InBuffer(address, buffer); //Push start address
+    buffer = WriteEncodedData(data, numOfData, encoding, buffer); //Push data
+    *buffer++ = '#';
+    EndFrame(frame, buffer);
+}
+void BuildSequencedWriteFrame(uint8_t sequence, uint32_t address, const uint8_t* data, uint32_t numOfData, uint8_t encoding, uint8_t checksumType, std::string& frame)
+{
+    uint8_t checksum[MAX_CHECKSUM_SIZE];
+    uint8_t checksumSize = GetChecksumBytes(data, numOfData, checksumType, checksum);
+
+    char* buffer = BeginFrame(frame, 3 + UINT8_STRING_SIZE + GetEncodedMaxSize(checksumSize, encoding) + UINT24_STRING_SIZE + GetEncodedMaxSize(numOfData, encoding));
+    *buffer++ = '$';
+    *buffer++ = 'P';
+    buffer = WriteUint8InBuffer(sequence, buffer); //Push sequence number
+    buffer = WriteEncodedData(checksum, checksumSize, encoding, buffer); //Push checksum
+    buffer = WriteUint24InBuffer(address, buffer); //Push start address
+    buffer = WriteEncodedData(data, numOfData, encoding, buffer); //Push data
+    *buffer++ = '#';
+    EndFrame(frame, buffer);
+}
+void BuildCompressedWriteFrame(uint32_t address, const uint8_t* data, uint32_t numOfData, uint8_t compression, const uint8_t* compressedData, std::size_t compressedSize,
+                               uint8_t encoding, uint8_t checksumType, std::string& frame)
+{
+    char* buffer = BeginFrame(frame, GetCompressedFrameMaxSize(compressedSize, GetChecksumSize(checksumType), encoding));
+    *buffer++ = '$';
+    *buffer++ = 'Z';
+    buffer = WriteCompressedPayload(address, data, numOfData, compression, compressedData, compressedSize, encoding, checksumType, buffer);
+    EndFrame(frame, buffer);
+}
+void BuildSequencedCompressedWriteFrame(uint8_t sequence, uint32_t address, const uint8_t* data, uint32_t numOfData, uint8_t compression, const uint8_t* compressedData, std::size_t compressedSize,
+                                        uint8_t encoding, uint8_t checksumType, std::string& frame)
+{
+    char* buffer = BeginFrame(frame, GetCompressedFrameMaxSize(compressedSize, GetChecksumSize(checksumType), encoding));
+    *buffer++ = '$';
+    *buffer++ = 'Y';
+    buffer = WriteUint8InBuffer(sequence, buffer); //Push sequence number
+    buffer = WriteCompressedPayload(address, data, numOfData, compression, compressedData, compressedSize, encoding, checksumType, buffer);
+    EndFrame(frame, buffer);
+}
+void BuildReadFrame(uint32_t address, uint32_t numOfData, std::string& frame)
+{
+    char* buffer = BeginFrame(frame, 3 + 2*UINT24_STRING_SIZE);
+    *buffer++ = '$';
+    *buffer++ = 'R';
+    buffer = WriteUint24InBuffer(address, buffer); //Push start address
+    buffer = WriteUint24InBuffer(numOfData, buffer); //Push num of data
+    *buffer++ = '#';
+    EndFrame(frame, buffer);
+}
+void BuildFlashEraseFrame(uint8_t startSector, uint8_t countSector, std::string& frame)
+{
+    char* buffer = BeginFrame(frame, 11);
+    *buffer++ = '$';
+    *buffer++ = 'F';
+    *buffer++ = 'E';
+    *buffer++ = 'S';
+    buffer = WriteUint8InBuffer(startSector, buffer);
+    buffer = WriteUint8InBuffer(countSector, buffer);
+    *buffer++ = '#';
+    EndFrame(frame, buffer);
+}
+void BuildBlankCheckFrame(uint32_t address, uint32_t numOfData, std::string& frame)
+{
+    char* buffer = BeginFrame(frame, 3 + 2*UINT24_STRING_SIZE);
+    *buffer++ = '$';
+    *buffer++ = 'K';
+    buffer = WriteUint24InBuffer(address, buffer); //Push start address
+    buffer = WriteUint24InBuffer(numOfData, buffer); //Push num of data
+    *buffer++ = '#';
+    EndFrame(frame, buffer);
+}
+
+void BuildRangeCrcFrame(uint32_t address, uint32_t numOfData, std::string& frame)
+{
+    char* buffer = BeginFrame(frame, 3 + 2*UINT24_STRING_SIZE);
+    *buffer++ = '$';
+    *buffer++ = 'C';
+    buffer = WriteUint24InBuffer(address, buffer); //Push start address
+    buffer = WriteUint24InBuffer(numOfData, buffer); //Push num of data
+    *buffer++ = '#';
+    EndFrame(frame, buffer);
+}
+bool GetRangeCrc(const std::string& reply, uint32_t& crc)
+{
+    if ( reply.size() != FRAME_CRC_SIZE || reply.compare(0, 3, "CRC") != 0 || reply.back() != '\n' )
+    {
+        return false;
+    }
+
+    return GetUint32FromHexString(reply, 3, crc);
+}
+
+std::size_t GetReadReplySize(const uint8_t* data, uint32_t numOfData, uint8_t encoding, uint8_t checksumType)
+{
+    uint8_t checksum[MAX_CHECKSUM_SIZE];
+    uint8_t checksumSize = GetChecksumBytes(data, numOfData, checksumType, checksum);
+    return FRAME_READHEADER_SIZE + GetEncodedSize(checksum, checksumSize, encoding) + UINT24_STRING_SIZE + GetEncodedSize(data, numOfData, encoding) + 1;
+}
+bool CheckReadReply(const std::string& reply, uint32_t address, const uint8_t* data, uint32_t numOfData, uint8_t encoding, uint8_t checksumType)
+{
+    uint8_t checksum[MAX_CHECKSUM_SIZE];
+    uint8_t checksumSize = GetChecksumBytes(data, numOfData, checksumType, checksum);
+
+    //The header and the terminator are not checked, only their size
+    if ( reply.size() != FRAME_READHEADER_SIZE + GetEncodedSize(checksum, checksumSize, encoding) + UINT24_STRING_SIZE + GetEncodedSize(data, numOfData, encoding) + 1 )
+    {
+        return false;
+    }
+
+    std::size_t pos = FRAME_READHEADER_SIZE;
+
+    if ( !MatchEncodedData(reply, pos, checksum, checksumSize, encoding) )
+    {
+        return false;
+    }
+
+    char addressDigits[UINT24_STRING_SIZE];
+    WriteUint24InBuffer(address, addressDigits);
+    if ( reply.compare(pos, UINT24_STRING_SIZE, addressDigits, UINT24_STRING_SIZE) != 0 )
+    {
+        return false;
+    }
+    pos += UINT24_STRING_SIZE;
+
+    return MatchEncodedData(reply, pos, data, numOfData, encoding);
+}
+
+bool GetWritedSequence(const std::string& reply, uint8_t& sequence)
+{
+    if ( reply.size() != FRAME_WRITEDSEQ_SIZE || reply.compare(0, 6, "WRITED") != 0 || reply.back() != '\n' )
+    {
+        return false;
+    }
+    return GetUint8FromString(reply, 6, sequence);
+}
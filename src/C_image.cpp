@@ -0,0 +1,451 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "C_image.hpp"
+#include <algorithm>
+#include <cctype>
+
+namespace
+{
+
+bool GetHexValue(char c, uint8_t& value)
+{
+    if (c >= '0' && c <= '9')
+    {
+        value = c - '0';
+    }
+    else if (c >= 'A' && c <= 'F')
+    {
+        value = c - 'A' + 10;
+    }
+    else if (c >= 'a' && c <= 'f')
+    {
+        value = c - 'a' + 10;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+//Decode the hexadecimal pairs of a record line, from pos to the end
+bool GetRecordBytes(const std::string& line, std::size_t pos, std::vector<uint8_t>& bytes)
+{
+    bytes.clear();
+    if ( (line.size()-pos) % 2 != 0 )
+    {
+        return false;
+    }
+    for (; pos<line.size(); pos+=2)
+    {
+        uint8_t high, low;
+        if ( !GetHexValue(line[pos], high) || !GetHexValue(line[pos+1], low) )
+        {
+            return false;
+        }
+        bytes.push_back((high<<4) | low);
+    }
+    return true;
+}
+
+//Next line without the trailing spaces, the empty lines are skipped
+bool GetRecordLine(std::istream& input, std::string& line, std::size_t& lineNumber)
+{
+    while ( std::getline(input, line) )
+    {
+        ++lineNumber;
+        while ( !line.empty() && std::isspace(static_cast<unsigned char>(line.back())) )
+        {
+            line.pop_back();
+        }
+        if ( !line.empty() )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string GetExtension(const std::string& path)
+{
+    std::size_t pos = path.find_last_of("./\\");
+    if (pos == std::string::npos || path[pos] != '.')
+    {
+        return std::string();
+    }
+
+    std::string extension = path.substr(pos+1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c){
+        return std::tolower(c);
+    });
+    return extension;
+}
+
+} // namespace
+
+uint8_t GetImageFormat(const std::string& name)
+{
+    if (name == "auto")
+    {
+        return IMAGE_AUTO;
+    }
+    if (name == "binary")
+    {
+        return IMAGE_BINARY;
+    }
+    if (name == "ihex")
+    {
+        return IMAGE_IHEX;
+    }
+    if (name == "srec")
+    {
+        return IMAGE_SREC;
+    }
+    return IMAGE_UNKNOWN;
+}
+const char* GetImageFormatName(uint8_t format)
+{
+    switch (format)
+    {
+    case IMAGE_AUTO:
+        return "auto";
+    case IMAGE_BINARY:
+        return "binary";
+    case IMAGE_IHEX:
+        return "Intel HEX";
+    case IMAGE_SREC:
+        return "Motorola S-record";
+    default:
+        return "unknown";
+    }
+}
+uint8_t GetImageFormatFromPath(const std::string& path)
+{
+    const std::string extension = GetExtension(path);
+
+    if (extension == "hex" || extension == "ihex" || extension == "ihx")
+    {
+        return IMAGE_IHEX;
+    }
+    if (extension == "srec" || extension == "s19" || extension == "s28" || extension == "s37" || extension == "mot")
+    {
+        return IMAGE_SREC;
+    }
+    if (extension == "bin" || extension == "cg")
+    {
+        return IMAGE_BINARY;
+    }
+    return IMAGE_AUTO;
+}
+uint8_t DetectImageFormat(std::istream& input)
+{
+    const std::istream::pos_type start = input.tellg();
+
+    std::string line;
+    std::getline(input, line);
+    while ( !line.empty() && std::isspace(static_cast<unsigned char>(line.back())) )
+    {
+        line.pop_back();
+    }
+
+    input.clear();
+    input.seekg(start);
+
+    //A record line is only made of hexadecimal digits after its start code
+    std::size_t pos;
+    uint8_t format;
+    if (line.size() > 1 && line[0] == ':')
+    {
+        pos = 1;
+        format = IMAGE_IHEX;
+    }
+    else if (line.size() > 2 && line[0] == 'S' && std::isdigit(static_cast<unsigned char>(line[1])))
+    {
+        pos = 2;
+        format = IMAGE_SREC;
+    }
+    else
+    {
+        return IMAGE_BINARY;
+    }
+
+    uint8_t value;
+    for (; pos<line.size(); ++pos)
+    {
+        if ( !GetHexValue(line[pos], value) )
+        {
+            return IMAGE_BINARY;
+        }
+    }
+    return format;
+}
+
+bool SplitImageInput(const std::string& input, uint32_t& address, std::string& path)
+{
+    address = 0;
+    path = input;
+
+    std::size_t pos = input.find(':');
+    if (pos == 0 || pos == std::string::npos)
+    {
+        return false;
+    }
+
+    const std::string number = input.substr(0, pos);
+    const bool hexadecimal = (number.size() > 2 && number[0] == '0' && (number[1] == 'x' || number[1] == 'X'));
+    const std::string digits = hexadecimal ? number.substr(2) : number;
+
+    uint8_t value;
+    uint64_t result = 0;
+    for (char c : digits)
+    {
+        if ( hexadecimal ? !GetHexValue(c, value) : !std::isdigit(static_cast<unsigned char>(c)) )
+        {
+            return false;
+        }
+        result = result * (hexadecimal ? 16 : 10) + (hexadecimal ? value : c - '0');
+        if (result > 0xFFFFFFFF)
+        {
+            return false;
+        }
+    }
+
+    address = static_cast<uint32_t>(result);
+    path = input.substr(pos+1);
+    return true;
+}
+
+bool ParseIntelHex(std::istream& input, uint32_t offset, MemoryImage& image, std::ostream& log)
+{
+    std::string line;
+    std::size_t lineNumber = 0;
+    std::vector<uint8_t> bytes;
+    uint32_t baseAddress = 0; //From the extended segment or linear address records
+
+    while ( GetRecordLine(input, line, lineNumber) )
+    {
+        //:<count><address 16><type><data><checksum>
+        if ( line[0] != ':' || !GetRecordBytes(line, 1, bytes) || bytes.size() < 5 || bytes.size() != bytes[0] + 5u )
+        {
+            log << "Bad Intel HEX record at line " << lineNumber << " !" << std::endl;
+            return false;
+        }
+
+        uint8_t sum = 0;
+        for (uint8_t value : bytes)
+        {
+            sum += value;
+        }
+        if (sum != 0)
+        {
+            log << "Bad Intel HEX checksum at line " << lineNumber << " !" << std::endl;
+            return false;
+        }
+
+        const uint8_t count = bytes[0];
+        const uint16_t address = (bytes[1]<<8) | bytes[2];
+        const uint8_t* data = bytes.data() + 4;
+
+        switch (bytes[3])
+        {
+        case 0x00: //Data
+            if ( !AddImageData(image, offset + baseAddress + address, data, count, log) )
+            {
+                return false;
+            }
+            break;
+        case 0x01: //End of file
+            return true;
+        case 0x02: //Extended segment address
+        case 0x04: //Extended linear address
+            if (count != 2)
+            {
+                log << "Bad Intel HEX record at line " << lineNumber << " !" << std::endl;
+                return false;
+            }
+            baseAddress = (data[0]<<8) | data[1];
+            baseAddress <<= (bytes[3] == 0x02) ? 4 : 16;
+            break;
+        case 0x03: //Start segment address
+        case 0x05: //Start linear address
+            break;
+        default:
+            log << "Unknown Intel HEX record type " << static_cast<unsigned int>(bytes[3]) << " at line " << lineNumber << " !" << std::endl;
+            return false;
+        }
+    }
+
+    log << "The Intel HEX file has no end of file record !" << std::endl;
+    return false;
+}
+bool ParseSRecord(std::istream& input, uint32_t offset, MemoryImage& image, std::ostream& log)
+{
+    std::string line;
+    std::size_t lineNumber = 0;
+    std::vector<uint8_t> bytes;
+
+    while ( GetRecordLine(input, line, lineNumber) )
+    {
+        //S<type><count><address><data><checksum>, the count covers the address, the data and the checksum
+        if ( line.size() < 2 || line[0] != 'S' || !GetRecordBytes(line, 2, bytes) || bytes.size() < 2 || bytes.size() != bytes[0] + 1u )
+        {
+            log << "Bad S-record at line " << lineNumber << " !" << std::endl;
+            return false;
+        }
+
+        uint8_t sum = 0;
+        for (uint8_t value : bytes)
+        {
+            sum += value;
+        }
+        if (sum != 0xFF)
+        {
+            log << "Bad S-record checksum at line " << lineNumber << " !" << std::endl;
+            return false;
+        }
+
+        const char type = line[1];
+        std::size_t addressSize;
+        switch (type)
+        {
+        case '0': //Header
+        case '1': //Data
+        case '5': //Record count
+        case '9': //End with a start address
+            addressSize = 2;
+            break;
+        case '2':
+        case '6':
+        case '8':
+            addressSize = 3;
+            break;
+        case '3':
+        case '7':
+            addressSize = 4;
+            break;
+        default:
+            log << "Unknown S-record type S" << type << " at line " << lineNumber << " !" << std::endl;
+            return false;
+        }
+
+        if (bytes.size() < addressSize + 2)
+        {
+            log << "Bad S-record at line " << lineNumber << " !" << std::endl;
+            return false;
+        }
+
+        uint32_t address = 0;
+        for (std::size_t i=0; i<addressSize; ++i)
+        {
+            address = (address<<8) | bytes[1+i];
+        }
+
+        switch (type)
+        {
+        case '1':
+        case '2':
+        case '3':
+            if ( !AddImageData(image, offset + address, bytes.data()+1+addressSize, bytes.size()-addressSize-2, log) )
+            {
+                return false;
+            }
+            break;
+        case '7':
+        case '8':
+        case '9':
+            return true;
+        default:
+            break;
+        }
+    }
+
+    log << "The S-record file has no termination record !" << std::endl;
+    return false;
+}
+bool AddImageData(MemoryImage& image, uint32_t address, const uint8_t* data, std::size_t size, std::ostream& log)
+{
+    if (size == 0)
+    {
+        return true;
+    }
+
+    const uint64_t endAddress = static_cast<uint64_t>(address) + size;
+    if (endAddress > MAX_IMAGE_SIZE)
+    {
+        log << "The data at address " << address << " is beyond the last address of the frames (" << (MAX_IMAGE_SIZE-1) << ") !" << std::endl;
+        return false;
+    }
+
+    if (image.data.size() < endAddress)
+    {
+        image.data.resize(endAddress, IMAGE_FILLER);
+    }
+    std::copy(data, data+size, image.data.begin()+address);
+
+    PushRange(image.segments, address, size);
+    return true;
+}
+
+bool FinishImage(MemoryImage& image, std::ostream& log)
+{
+    std::stable_sort(image.segments.begin(), image.segments.end(), [](const AddressRange& a, const AddressRange& b){
+        return a.address < b.address;
+    });
+
+    AddressRangeList segments;
+    for (const AddressRange& segment : image.segments)
+    {
+        if ( !segments.empty() && segments.back().address+segments.back().size > segment.address )
+        {
+            log << "The data at address " << segment.address << " is given twice !" << std::endl;
+            return false;
+        }
+        PushRange(segments, segment.address, segment.size);
+    }
+    image.segments.swap(segments);
+    return true;
+}
+bool IsFlatImage(const MemoryImage& image)
+{
+    return image.segments.size() == 1 && image.segments[0].address == 0 && image.segments[0].size == image.data.size();
+}
+
+void PackSegments(const std::vector<uint8_t>& data, const AddressRangeList& segments, std::vector<uint8_t>& packedData)
+{
+    packedData.clear();
+    packedData.reserve(GetRangesSize(segments));
+    for (const AddressRange& segment : segments)
+    {
+        packedData.insert(packedData.end(), data.begin()+segment.address, data.begin()+segment.address+segment.size);
+    }
+}
+bool UnpackSegments(const std::vector<uint8_t>& packedData, const AddressRangeList& segments, std::vector<uint8_t>& data)
+{
+    if ( segments.empty() || !CheckRanges(segments, MAX_IMAGE_SIZE) || packedData.size() != GetRangesSize(segments) )
+    {
+        return false;
+    }
+
+    data.assign(segments.back().address + segments.back().size, IMAGE_FILLER);
+    auto packedIt = packedData.begin();
+    for (const AddressRange& segment : segments)
+    {
+        std::copy(packedIt, packedIt+segment.size, data.begin()+segment.address);
+        packedIt += segment.size;
+    }
+    return true;
+}
@@ -0,0 +1,107 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "C_journal.hpp"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#define JOURNAL_HEADER "codeGTransfer journal 2" //The journals of another version are not resumed
+
+std::string GetJournalPath(const std::string& directory, const std::string& portName)
+{
+    std::ostringstream path;
+
+    if ( !directory.empty() )
+    {
+        path << directory;
+        if (directory.back() != '/' && directory.back() != '\\')
+        {
+            path << '/';
+        }
+    }
+
+    //"/dev/ttyUSB0" or "COM3" as a file name
+    std::string portFileName = portName;
+    std::replace_if(portFileName.begin(), portFileName.end(), [](char c){
+        return c == '/' || c == '\\' || c == ':';
+    }, '_');
+
+    path << "codeGTransfer_" << portFileName << ".journal";
+    return path.str();
+}
+
+bool LoadJournal(const std::string& path, TransferJournal& journal)
+{
+    std::ifstream fileIn(path);
+    if ( !fileIn )
+    {
+        return false;
+    }
+
+    std::string line;
+    if ( !std::getline(fileIn, line) || line != JOURNAL_HEADER )
+    {
+        return false;
+    }
+
+    unsigned int memoryModel;
+    unsigned int deltaMode;
+    std::size_t rangeCount;
+    if ( !(fileIn >> std::hex >> journal.imageHash >> std::dec >> journal.startAddress >> memoryModel
+                  >> journal.boardIdentity >> journal.progressAddress >> journal.erasedAddress >> deltaMode >> rangeCount) )
+    {
+        return false;
+    }
+    journal.memoryModel = static_cast<uint8_t>(memoryModel);
+    journal.deltaMode = static_cast<uint8_t>(deltaMode);
+
+    journal.writeRanges.clear();
+    for (std::size_t i=0; i<rangeCount; ++i)
+    {
+        AddressRange range;
+        if ( !(fileIn >> range.address >> range.size) )
+        {
+            return false;
+        }
+        journal.writeRanges.push_back(range);
+    }
+    return true;
+}
+bool SaveJournal(const std::string& path, const TransferJournal& journal)
+{
+    std::ofstream fileOut(path, std::ios::trunc);
+    if ( !fileOut )
+    {
+        return false;
+    }
+
+    fileOut << JOURNAL_HEADER << '\n';
+    fileOut << std::hex << journal.imageHash << std::dec << '\n';
+    fileOut << journal.startAddress << '\n';
+    fileOut << static_cast<unsigned int>(journal.memoryModel) << '\n';
+    fileOut << journal.boardIdentity << '\n';
+    fileOut << journal.progressAddress << '\n';
+    fileOut << journal.erasedAddress << '\n';
+    fileOut << static_cast<unsigned int>(journal.deltaMode) << '\n';
+    fileOut << journal.writeRanges.size();
+    for (const AddressRange& range : journal.writeRanges)
+    {
+        fileOut << ' ' << range.address << ' ' << range.size;
+    }
+    fileOut << '\n';
+    return fileOut.good();
+}
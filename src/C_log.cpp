@@ -0,0 +1,62 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "C_log.hpp"
+
+PrefixedLogBuffer::PrefixedLogBuffer(std::ostream& output, std::mutex& mutex, const std::string& prefix) :
+    _g_output(output),
+    _g_mutex(mutex),
+    _g_prefix(prefix)
+{
+}
+PrefixedLogBuffer::~PrefixedLogBuffer()
+{
+    if ( !this->_g_line.empty() )
+    {
+        this->_g_line += '\n';
+        this->writeLine();
+    }
+}
+
+PrefixedLogBuffer::int_type PrefixedLogBuffer::overflow(int_type c)
+{
+    if ( traits_type::eq_int_type(c, traits_type::eof()) )
+    {
+        return traits_type::not_eof(c);
+    }
+
+    this->_g_line += traits_type::to_char_type(c);
+    if (this->_g_line.back() == '\n')
+    {
+        this->writeLine();
+    }
+    return c;
+}
+std::streamsize PrefixedLogBuffer::xsputn(const char* s, std::streamsize count)
+{
+    for (std::streamsize i=0; i<count; ++i)
+    {
+        this->overflow(traits_type::to_int_type(s[i]));
+    }
+    return count;
+}
+
+void PrefixedLogBuffer::writeLine()
+{
+    std::lock_guard<std::mutex> lock(this->_g_mutex);
+    this->_g_output << this->_g_prefix << this->_g_line << std::flush;
+    this->_g_line.clear();
+}
@@ -0,0 +1,171 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "C_manifest.hpp"
+#include "C_checksum.hpp"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#define MANIFEST_HEADER "codeGTransfer manifest 1"
+#define SECTORHASHES_HEADER "codeGTransfer sectors 1"
+
+namespace
+{
+
+void WriteSectorHashes(std::ostream& fileOut, const SectorHashMap& sectors)
+{
+    for (const auto& sector : sectors)
+    {
+        fileOut << sector.first << ' ' << sector.second.address << ' ' << sector.second.size << ' '
+                << std::hex << sector.second.hash << std::dec << '\n';
+    }
+}
+
+} // namespace
+
+std::string GetBoardIdentity(const std::string& information)
+{
+    std::ostringstream identity;
+    identity << std::hex << std::setw(16) << std::setfill('0')
+             << CalculateHash(reinterpret_cast<const uint8_t*>(information.data()), information.size());
+    return identity.str();
+}
+std::string GetManifestPath(const std::string& directory, const std::string& boardIdentity, uint8_t memoryModel)
+{
+    std::ostringstream path;
+
+    if ( !directory.empty() )
+    {
+        path << directory;
+        if (directory.back() != '/' && directory.back() != '\\')
+        {
+            path << '/';
+        }
+    }
+
+    path << "codeGTransfer_" << boardIdentity << '_' << static_cast<unsigned int>(memoryModel) << ".manifest";
+    return path.str();
+}
+
+bool LoadManifest(const std::string& path, const std::string& boardIdentity, uint32_t sectorSize, SectorHashMap& sectors)
+{
+    std::ifstream fileIn(path);
+    if ( !fileIn )
+    {
+        return false;
+    }
+
+    std::string line;
+    if ( !std::getline(fileIn, line) || line != MANIFEST_HEADER )
+    {
+        return false;
+    }
+    if ( !std::getline(fileIn, line) || line != boardIdentity )
+    {
+        return false;
+    }
+
+    uint32_t manifestSectorSize = 0;
+    if ( !std::getline(fileIn, line) || !(std::istringstream(line) >> manifestSectorSize) || manifestSectorSize != sectorSize )
+    {
+        return false;
+    }
+
+    sectors.clear();
+    while ( std::getline(fileIn, line) )
+    {
+        std::istringstream lineStream(line);
+        uint32_t sector;
+        SectorHash sectorHash;
+
+        if ( !(lineStream >> sector >> sectorHash.address >> sectorHash.size >> std::hex >> sectorHash.hash) )
+        {
+            sectors.clear();
+            return false;
+        }
+        sectors[sector] = sectorHash;
+    }
+    return true;
+}
+bool SaveManifest(const std::string& path, const std::string& boardIdentity, uint32_t sectorSize, const SectorHashMap& sectors)
+{
+    std::ofstream fileOut(path, std::ios::trunc);
+    if ( !fileOut )
+    {
+        return false;
+    }
+
+    fileOut << MANIFEST_HEADER << '\n';
+    fileOut << boardIdentity << '\n';
+    fileOut << sectorSize << '\n';
+
+    WriteSectorHashes(fileOut, sectors);
+    return fileOut.good();
+}
+bool SaveSectorHashes(const std::string& path, uint32_t sectorSize, const SectorHashMap& sectors)
+{
+    std::ofstream fileOut(path, std::ios::trunc);
+    if ( !fileOut )
+    {
+        return false;
+    }
+
+    fileOut << SECTORHASHES_HEADER << '\n';
+    fileOut << sectorSize << '\n';
+
+    WriteSectorHashes(fileOut, sectors);
+    return fileOut.good();
+}
+
+void HashSectors(const uint8_t* data, uint32_t address, uint32_t size, uint32_t sectorSize, SectorHashMap& sectors)
+{
+    const uint32_t endAddress = address + size;
+
+    while (address < endAddress)
+    {
+        uint32_t sector = address / sectorSize;
+        uint32_t sectorEnd = std::min((sector+1) * sectorSize, endAddress);
+
+        SectorHash& sectorHash = sectors[sector];
+        sectorHash.address = address;
+        sectorHash.size = sectorEnd - address;
+        sectorHash.hash = CalculateHash(data, sectorHash.size);
+
+        data += sectorHash.size;
+        address = sectorEnd;
+    }
+}
+void HashSectors(const uint8_t* data, const AddressRangeList& ranges, uint32_t sectorSize, SectorHashMap& sectors)
+{
+    AddressRangeList sectorRanges;
+    GetSectorRanges(ranges, sectorSize, sectorRanges);
+
+    for (const AddressRange& sectorRange : sectorRanges)
+    {
+        for (uint32_t sector=sectorRange.address; sector<sectorRange.address+sectorRange.size; ++sector)
+        {
+            AddressRangeList covered;
+            IntersectRanges(ranges, sector*sectorSize, sectorSize, covered);
+
+            SectorHash& sectorHash = sectors[sector];
+            sectorHash.address = covered.front().address;
+            sectorHash.size = covered.back().address + covered.back().size - sectorHash.address;
+            sectorHash.hash = CalculateHash(data+sectorHash.address, sectorHash.size);
+        }
+    }
+}
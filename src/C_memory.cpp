@@ -0,0 +1,152 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "C_memory.hpp"
+#include "C_board.hpp"
+#include "C_string.hpp"
+#include <vector>
+#include <algorithm>
+
+const char* GetMemoryModelName(uint8_t memoryModel)
+{
+    return (memoryModel == MEMM_FLASH) ? "FLASH" : "EEPROM";
+}
+
+MemoryGeometry GetDefaultGeometry(uint8_t memoryModel)
+{
+    //Unknown boards keep the flash geometry of the first MM1 writer
+    MemoryGeometry geometry;
+    if (memoryModel == MEMM_EEPROM)
+    {
+        //Written by page without erase, the frames end on a page boundary
+        geometry.pageSize = DEFAULT_EEPROM_PAGESIZE;
+        geometry.sectorSize = DEFAULT_EEPROM_SECTORSIZE;
+        geometry.writeTime = DEFAULT_EEPROM_WRITETIME;
+    }
+    return geometry;
+}
+
+bool GetBoardGeometry(const std::string& information, uint8_t memoryModel, MemoryGeometry& geometry)
+{
+    geometry = GetDefaultGeometry(memoryModel);
+
+    std::string values;
+    if ( !GetBoardCapability(information, GetMemoryModelName(memoryModel), values) )
+    {
+        return true;
+    }
+
+    std::vector<std::string> splitedValues;
+    Split(values, splitedValues, ',');
+    for (const std::string& splitedValue : splitedValues)
+    {
+        std::string::size_type separator = splitedValue.find(':');
+        if (separator == std::string::npos)
+        {
+            return false;
+        }
+        const std::string name = splitedValue.substr(0, separator);
+
+        uint32_t value;
+        try
+        {
+            value = std::stoul(splitedValue.substr(separator+1), nullptr, (name == "ERASED") ? 16 : 10);
+        }
+        catch (std::exception&)
+        {
+            return false;
+        }
+
+        if (name == "PAGE")
+        {
+            geometry.pageSize = value;
+        }
+        else if (name == "SECTOR")
+        {
+            if (value == 0)
+            {
+                return false;
+            }
+            geometry.sectorSize = value;
+        }
+        else if (name == "PAYLOAD")
+        {
+            if (value == 0 || value > MAX_NUMOFDATA)
+            {
+                return false;
+            }
+            geometry.maxPayload = value;
+        }
+        else if (name == "ERASED")
+        {
+            if (value > 0xFF)
+            {
+                return false;
+            }
+            geometry.erasedValue = static_cast<uint8_t>(value);
+        }
+        else if (name == "WRITE")
+        {
+            geometry.writeTime = value;
+        }
+        else if (name == "ERASE")
+        {
+            geometry.eraseTime = value;
+        }
+        //Unknown names are ignored, for the future
+    }
+    return true;
+}
+
+uint32_t GetChunkSize(const MemoryGeometry& geometry, uint32_t address, uint32_t sizeLeft)
+{
+    uint32_t size = std::min(geometry.maxPayload, sizeLeft);
+    if (geometry.pageSize == 0)
+    {
+        return size;
+    }
+
+    const uint32_t endAddress = address + size;
+    const uint32_t alignedEndAddress = endAddress - endAddress%geometry.pageSize;
+    if (alignedEndAddress > address)
+    {
+        return alignedEndAddress - address;
+    }
+    return size; //Inside a single page
+}
+
+uint32_t GetWriteTimeout(const MemoryGeometry& geometry, uint32_t address, uint32_t numOfData)
+{
+    if (geometry.writeTime == 0)
+    {
+        return DEFAULT_WRITE_TIMEOUT;
+    }
+
+    uint32_t numOfWrites = 1;
+    if (geometry.pageSize != 0 && numOfData != 0)
+    {
+        numOfWrites = (address+numOfData-1)/geometry.pageSize - address/geometry.pageSize + 1;
+    }
+    return static_cast<uint32_t>(static_cast<uint64_t>(numOfWrites) * geometry.writeTime * TIMING_MARGIN / 1000) + 1;
+}
+uint32_t GetEraseTimeout(const MemoryGeometry& geometry, uint32_t numOfSectors)
+{
+    if (geometry.eraseTime == 0)
+    {
+        return numOfSectors * DEFAULT_ERASE_TIMEOUT;
+    }
+    return static_cast<uint32_t>(static_cast<uint64_t>(numOfSectors) * geometry.eraseTime * TIMING_MARGIN / 1000) + 1;
+}
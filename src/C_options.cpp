@@ -0,0 +1,382 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+#include "C_options.hpp"
+#include "C_transfer.hpp"
+#include "C_string.hpp"
+#include "C_image.hpp"
+#include <vector>
+#include <sstream>
+
+uint8_t ParseTransferOption(const std::string& option, TransferSettings& settings, std::ostream& log)
+{
+    if (option == "--verify")
+    {
+        settings.enableWrite = false;
+        return OPTION_PARSED;
+    }
+    if (option == "--noErase")
+    {
+        settings.enableFlashErase = false;
+        return OPTION_PARSED;
+    }
+    if (option == "--delta")
+    {
+        settings.deltaMode = DELTA_AUTO;
+        return OPTION_PARSED;
+    }
+    if (option == "--sparse")
+    {
+        settings.sparseMode = true;
+        return OPTION_PARSED;
+    }
+    if (option == "--resume")
+    {
+        settings.resume = true;
+        return OPTION_PARSED;
+    }
+    if (option == "--quiet")
+    {
+        settings.quiet = true;
+        return OPTION_PARSED;
+    }
+    if (option == "--rtscts")
+    {
+        settings.hardwareFlowControl = true;
+        return OPTION_PARSED;
+    }
+
+    //Options with an argument
+    std::vector<std::string> splitedOption;
+    Split(option, splitedOption, '=');
+
+    if (splitedOption.size() == 2)
+    {
+        if ( splitedOption[0] == "--model")
+        {
+            if (splitedOption[1] == "eeprom")
+            {
+                settings.memoryModel = MEMM_EEPROM;
+            }
+            else if (splitedOption[1] == "flash")
+            {
+                settings.memoryModel = MEMM_FLASH;
+            }
+            else if (splitedOption[1] == "default")
+            {
+                settings.memoryModel = MEMM_EEPROM;
+            }
+            else
+            {
+                log << "Unknown memory model : \""<< splitedOption[1] <<"\" !" << std::endl;
+                return OPTION_ERROR;
+            }
+            return OPTION_PARSED;
+        }
+        if ( splitedOption[0] == "--start")
+        {
+            uint64_t startAddress;
+            try
+            {
+                startAddress = std::stoull(splitedOption[1]);
+            }
+            catch (std::exception& e)
+            {
+                log << "Can't convert \""<< splitedOption[1] << "\" as a number !" << std::endl;
+                log << e.what() << std::endl;
+                return OPTION_ERROR;
+            }
+            if (startAddress >= MAX_IMAGE_SIZE)
+            {
+                log << "The start address must be below " << MAX_IMAGE_SIZE << " !" << std::endl;
+                return OPTION_ERROR;
+            }
+            settings.startAddress = static_cast<uint32_t>(startAddress);
+            return OPTION_PARSED;
+        }
+        if ( splitedOption[0] == "--retry")
+        {
+            try
+            {
+                settings.retryCount = std::stoul(splitedOption[1]);
+            }
+            catch (std::exception& e)
+            {
+                log << "Can't convert \""<< splitedOption[1] << "\" as a number !" << std::endl;
+                log << e.what() << std::endl;
+                return OPTION_ERROR;
+            }
+            return OPTION_PARSED;
+        }
+        if ( splitedOption[0] == "--window")
+        {
+            try
+            {
+                settings.windowSize = std::stoul(splitedOption[1]);
+            }
+            catch (std::exception& e)
+            {
+                log << "Can't convert \""<< splitedOption[1] << "\" as a number !" << std::endl;
+                log << e.what() << std::endl;
+                return OPTION_ERROR;
+            }
+            if (settings.windowSize == 0 || settings.windowSize > MAX_WINDOWSIZE)
+            {
+                log << "The window size must be between 1 and " << MAX_WINDOWSIZE << " !" << std::endl;
+                return OPTION_ERROR;
+            }
+            return OPTION_PARSED;
+        }
+        if ( splitedOption[0] == "--verifyMode")
+        {
+            if (splitedOption[1] == "immediate")
+            {
+                settings.verifyMode = VERIFY_IMMEDIATE;
+            }
+            else if (splitedOption[1] == "deferred")
+            {
+                settings.verifyMode = VERIFY_DEFERRED;
+            }
+            else if (splitedOption[1] == "crc")
+            {
+                settings.verifyMode = VERIFY_CRC;
+            }
+            else
+            {
+                log << "Unknown verify mode : \""<< splitedOption[1] <<"\" !" << std::endl;
+                return OPTION_ERROR;
+            }
+            return OPTION_PARSED;
+        }
+        if ( splitedOption[0] == "--baud")
+        {
+            if (splitedOption[1] == "max")
+            {
+                settings.targetBaudrate = 99999999;
+                return OPTION_PARSED;
+            }
+            try
+            {
+                settings.targetBaudrate = std::stoul(splitedOption[1]);
+            }
+            catch (std::exception& e)
+            {
+                log << "Can't convert \""<< splitedOption[1] << "\" as a number !" << std::endl;
+                log << e.what() << std::endl;
+                return OPTION_ERROR;
+            }
+            if (settings.targetBaudrate > 99999999)
+            {
+                log << "The baudrate can't be higher than 99999999 !" << std::endl;
+                return OPTION_ERROR;
+            }
+            return OPTION_PARSED;
+        }
+        if ( splitedOption[0] == "--delta")
+        {
+            if (splitedOption[1] == "readback")
+            {
+                settings.deltaMode = DELTA_READBACK;
+            }
+            else
+            {
+                log << "Unknown delta mode : \""<< splitedOption[1] <<"\" !" << std::endl;
+                return OPTION_ERROR;
+            }
+            return OPTION_PARSED;
+        }
+        if ( splitedOption[0] == "--manifestDir")
+        {
+            settings.manifestDirectory = splitedOption[1];
+            return OPTION_PARSED;
+        }
+        if ( splitedOption[0] == "--encoding")
+        {
+            if (splitedOption[1] == "auto")
+            {
+                settings.autoEncoding = true;
+            }
+            else if ( GetEncodingFromName(splitedOption[1], settings.encoding) )
+            {
+                settings.autoEncoding = false;
+            }
+            else
+            {
+                log << "Unknown encoding : \""<< splitedOption[1] <<"\" !" << std::endl;
+                return OPTION_ERROR;
+            }
+            return OPTION_PARSED;
+        }
+        if ( splitedOption[0] == "--checksum")
+        {
+            if (splitedOption[1] == "auto")
+            {
+                settings.autoChecksum = true;
+            }
+            else if ( GetChecksumFromName(splitedOption[1], settings.checksumType) )
+            {
+                settings.autoChecksum = false;
+            }
+            else
+            {
+                log << "Unknown checksum : \""<< splitedOption[1] <<"\" !" << std::endl;
+                return OPTION_ERROR;
+            }
+            return OPTION_PARSED;
+        }
+        if ( splitedOption[0] == "--compression")
+        {
+            if (splitedOption[1] == "auto")
+            {
+                settings.autoCompression = true;
+            }
+            else if ( GetCompressionFromName(splitedOption[1], settings.compression) )
+            {
+                settings.autoCompression = false;
+            }
+            else
+            {
+                log << "Unknown compression : \""<< splitedOption[1] <<"\" !" << std::endl;
+                return OPTION_ERROR;
+            }
+            return OPTION_PARSED;
+        }
+        if ( splitedOption[0] == "--verifyBlock")
+        {
+            try
+            {
+                settings.verifyBlockSize = std::stoul(splitedOption[1]);
+            }
+            catch (std::exception& e)
+            {
+                log << "Can't convert \""<< splitedOption[1] << "\" as a number !" << std::endl;
+                log << e.what() << std::endl;
+                return OPTION_ERROR;
+            }
+            if (settings.verifyBlockSize == 0 || settings.verifyBlockSize > MAX_VERIFYBLOCK)
+            {
+                log << "The verify block size must be between 1 and " << MAX_VERIFYBLOCK << " !" << std::endl;
+                return OPTION_ERROR;
+            }
+            return OPTION_PARSED;
+        }
+        if ( splitedOption[0] == "--eraseAhead")
+        {
+            try
+            {
+                settings.eraseAhead = std::stoul(splitedOption[1]);
+            }
+            catch (std::exception& e)
+            {
+                log << "Can't convert \""<< splitedOption[1] << "\" as a number !" << std::endl;
+                log << e.what() << std::endl;
+                return OPTION_ERROR;
+            }
+            if (settings.eraseAhead > MAX_ERASEAHEAD)
+            {
+                log << "The erase lookahead must be between 0 and " << MAX_ERASEAHEAD << " sector(s) !" << std::endl;
+                return OPTION_ERROR;
+            }
+            return OPTION_PARSED;
+        }
+        if ( splitedOption[0] == "--dumpBlock")
+        {
+            try
+            {
+                settings.dumpBlockSize = std::stoul(splitedOption[1]);
+            }
+            catch (std::exception& e)
+            {
+                log << "Can't convert \""<< splitedOption[1] << "\" as a number !" << std::endl;
+                log << e.what() << std::endl;
+                return OPTION_ERROR;
+            }
+            if (settings.dumpBlockSize == 0 || settings.dumpBlockSize > MAX_VERIFYBLOCK)
+            {
+                log << "The dump block size must be between 1 and " << MAX_VERIFYBLOCK << " !" << std::endl;
+                return OPTION_ERROR;
+            }
+            return OPTION_PARSED;
+        }
+        if ( splitedOption[0] == "--segments")
+        {
+            std::vector<std::string> splitedSegments;
+            Split(splitedOption[1], splitedSegments, ',');
+
+            settings.segments.clear();
+            for (const std::string& segment : splitedSegments)
+            {
+                std::vector<std::string> splitedSegment;
+                Split(segment, splitedSegment, '+');
+
+                if (splitedSegment.size() != 2)
+                {
+                    log << "Can't convert \""<< segment << "\" as a segment, it must be <address>+<size> !" << std::endl;
+                    return OPTION_ERROR;
+                }
+
+                uint64_t address;
+                uint64_t size;
+                try
+                {
+                    address = std::stoull(splitedSegment[0]);
+                    size = std::stoull(splitedSegment[1]);
+                }
+                catch (std::exception& e)
+                {
+                    log << "Can't convert \""<< segment << "\" as a number !" << std::endl;
+                    log << e.what() << std::endl;
+                    return OPTION_ERROR;
+                }
+
+                if (address > MAX_IMAGE_SIZE || size > MAX_IMAGE_SIZE - address)
+                {
+                    log << "The segment \""<< segment << "\" is beyond the last address of the frames (" << (MAX_IMAGE_SIZE-1) << ") !" << std::endl;
+                    return OPTION_ERROR;
+                }
+                settings.segments.push_back({static_cast<uint32_t>(address), static_cast<uint32_t>(size)});
+                if ( !CheckRanges(settings.segments, MAX_IMAGE_SIZE) )
+                {
+                    log << "The segments must not be empty and must be sorted without overlap !" << std::endl;
+                    return OPTION_ERROR;
+                }
+            }
+            return OPTION_PARSED;
+        }
+    }
+
+    return OPTION_UNKNOWN;
+}
+
+std::string GetSegmentsOption(const AddressRangeList& segments)
+{
+    std::ostringstream option;
+    option << "--segments=";
+    for (std::size_t i=0; i<segments.size(); ++i)
+    {
+        option << (i ? "," : "") << segments[i].address << '+' << segments[i].size;
+    }
+    return option.str();
+}
+
+bool CheckTransferSettings(const TransferSettings& settings, std::ostream& log)
+{
+    if (settings.sparseMode && settings.memoryModel != MEMM_FLASH)
+    {
+        log << "The sparse mode needs an erased memory, only the flash memory model can be used !" << std::endl;
+        return false;
+    }
+    return true;
+}
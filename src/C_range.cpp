@@ -0,0 +1,165 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "C_range.hpp"
+#include <algorithm>
+
+namespace
+{
+
+//The ranges can end at 2^32, their end is always computed in 64 bits
+inline uint64_t GetRangeEnd(const AddressRange& range)
+{
+    return static_cast<uint64_t>(range.address) + range.size;
+}
+
+} // namespace
+
+void PushRange(AddressRangeList& ranges, uint32_t address, uint32_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+
+    if (!ranges.empty() && GetRangeEnd(ranges.back()) == address)
+    {
+        ranges.back().size += size;
+    }
+    else
+    {
+        ranges.push_back({address, size});
+    }
+}
+uint64_t GetRangesSize(const AddressRangeList& ranges)
+{
+    uint64_t size = 0;
+    for (const AddressRange& range : ranges)
+    {
+        size += range.size;
+    }
+    return size;
+}
+bool CheckRanges(const AddressRangeList& ranges, uint64_t endAddress)
+{
+    uint64_t previousEnd = 0;
+    for (const AddressRange& range : ranges)
+    {
+        if (range.size == 0 || range.address < previousEnd || GetRangeEnd(range) > endAddress)
+        {
+            return false;
+        }
+        previousEnd = GetRangeEnd(range);
+    }
+    return true;
+}
+void TrimRanges(AddressRangeList& ranges, uint32_t address)
+{
+    AddressRangeList trimmedRanges;
+    for (const AddressRange& range : ranges)
+    {
+        if (range.address >= address)
+        {
+            trimmedRanges.push_back(range);
+        }
+        else if (GetRangeEnd(range) > address)
+        {
+            trimmedRanges.push_back({address, static_cast<uint32_t>(GetRangeEnd(range) - address)});
+        }
+    }
+    ranges.swap(trimmedRanges);
+}
+void IntersectRanges(const AddressRangeList& ranges, uint32_t address, uint32_t size, AddressRangeList& intersection)
+{
+    const uint64_t endAddress = static_cast<uint64_t>(address) + size;
+
+    //First range ending after the address
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), address, [](uint32_t value, const AddressRange& range){
+        return value < GetRangeEnd(range);
+    });
+
+    for (; it != ranges.end() && it->address < endAddress; ++it)
+    {
+        uint32_t firstAddress = std::max(it->address, address);
+        uint64_t lastAddress = std::min(GetRangeEnd(*it), endAddress);
+        PushRange(intersection, firstAddress, static_cast<uint32_t>(lastAddress - firstAddress));
+    }
+}
+
+void GetSectorRanges(const AddressRangeList& ranges, uint32_t sectorSize, AddressRangeList& sectors)
+{
+    for (const AddressRange& range : ranges)
+    {
+        if (range.size == 0)
+        {
+            continue;
+        }
+
+        uint32_t firstSector = range.address / sectorSize;
+        uint32_t lastSector = static_cast<uint32_t>((GetRangeEnd(range) - 1) / sectorSize);
+
+        //Ranges are sorted, only the last sector can be shared with the previous range
+        if (!sectors.empty() && GetRangeEnd(sectors.back()) > firstSector)
+        {
+            firstSector = static_cast<uint32_t>(GetRangeEnd(sectors.back()));
+            if (firstSector > lastSector)
+            {
+                continue;
+            }
+        }
+        PushRange(sectors, firstSector, lastSector-firstSector+1);
+    }
+}
+
+void SplitBlankRanges(const uint8_t* data, const AddressRangeList& ranges, uint32_t chunkSize, uint8_t erasedValue,
+                      AddressRangeList& dataRanges, AddressRangeList& blankRanges)
+{
+    for (const AddressRange& range : ranges)
+    {
+        for (uint32_t offset=0, size=0; offset<range.size; offset+=size)
+        {
+            //Aligned on chunkSize so the blank chunks match the pages
+            uint32_t address = range.address + offset;
+            size = std::min(chunkSize - address%chunkSize, range.size-offset);
+
+            bool blank = std::all_of(data+address, data+address+size, [&](uint8_t value){
+                return value == erasedValue;
+            });
+            PushRange(blank ? blankRanges : dataRanges, address, size);
+        }
+    }
+}
+void CoalesceRanges(const uint8_t* data, AddressRangeList& ranges, uint32_t maxGap, uint8_t value)
+{
+    AddressRangeList coalescedRanges;
+    for (const AddressRange& range : ranges)
+    {
+        if ( !coalescedRanges.empty() )
+        {
+            AddressRange& previousRange = coalescedRanges.back();
+            const uint64_t gapAddress = GetRangeEnd(previousRange);
+
+            if (range.address >= gapAddress && range.address - gapAddress <= maxGap &&
+                std::all_of(data+gapAddress, data+range.address, [&](uint8_t gapValue){ return gapValue == value; }))
+            {
+                previousRange.size = static_cast<uint32_t>(GetRangeEnd(range) - previousRange.address);
+                continue;
+            }
+        }
+        coalescedRanges.push_back(range);
+    }
+    ranges.swap(coalescedRanges);
+}
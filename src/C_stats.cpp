@@ -0,0 +1,196 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "C_stats.hpp"
+#include <iomanip>
+#include <algorithm>
+
+namespace
+{
+
+uint32_t ToMicroseconds(StatsClock::duration duration)
+{
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+}
+
+double GetBytesPerSecond(uint64_t bytes, uint64_t time)
+{
+    return (time == 0) ? 0.0 : static_cast<double>(bytes) * 1000000.0 / static_cast<double>(time);
+}
+
+void WriteJsonString(const std::string& str, std::ostream& out)
+{
+    out << '"';
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out << '\\' << c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<unsigned int>(c) << std::dec << std::setfill(' ');
+        }
+        else
+        {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+void EndPhase(TransferStats* stats, const std::string& name, StatsClock::time_point& phaseStart)
+{
+    const StatsClock::time_point now = StatsClock::now();
+    if (stats != nullptr)
+    {
+        stats->phases.emplace_back(name, ToMicroseconds(now - phaseStart));
+    }
+    phaseStart = now;
+}
+void RecordCommand(TransferStats* stats, const std::string& name, std::size_t sentBytes, std::size_t receivedBytes, StatsClock::time_point sent)
+{
+    if (stats == nullptr)
+    {
+        return;
+    }
+
+    CommandStats& command = stats->commands[name];
+    ++command.count;
+    command.sentBytes += sentBytes;
+    command.receivedBytes += receivedBytes;
+    command.latencies.push_back(ToMicroseconds(StatsClock::now() - sent));
+}
+
+uint64_t GetWireBytes(const TransferStats& stats)
+{
+    uint64_t bytes = 0;
+    for (const auto& command : stats.commands)
+    {
+        bytes += command.second.sentBytes + command.second.receivedBytes;
+    }
+    return bytes;
+}
+uint32_t GetPercentile(std::vector<uint32_t> latencies, unsigned int percentile)
+{
+    if (latencies.empty())
+    {
+        return 0;
+    }
+    std::size_t index = (latencies.size()-1) * percentile / 100;
+    std::nth_element(latencies.begin(), latencies.begin()+index, latencies.end());
+    return latencies[index];
+}
+
+void PrintStats(const TransferStats& stats, std::ostream& out)
+{
+    const uint64_t wireBytes = GetWireBytes(stats);
+
+    out << "Statistics :" << std::endl;
+    out << "\ttotal " << stats.totalTime/1000 << " ms, " << stats.payloadBytes << " payload byte(s), "
+        << wireBytes << " byte(s) on the wire, " << stats.retries << " retry(ies)" << std::endl;
+    out << std::fixed << std::setprecision(0)
+        << "\teffective " << GetBytesPerSecond(stats.payloadBytes, stats.totalTime) << " byte(s)/s, wire "
+        << GetBytesPerSecond(wireBytes, stats.totalTime) << " byte(s)/s" << std::defaultfloat << std::endl;
+
+    for (const auto& phase : stats.phases)
+    {
+        out << "\t" << std::left << std::setw(12) << phase.first << std::right << std::setw(10) << phase.second/1000 << " ms" << std::endl;
+    }
+    for (const auto& command : stats.commands)
+    {
+        const std::vector<uint32_t>& latencies = command.second.latencies;
+        out << "\t$" << std::left << std::setw(11) << command.first << std::right
+            << std::setw(8) << command.second.count << " command(s)"
+            << "  p50 " << std::setw(8) << GetPercentile(latencies, 50)
+            << "  p90 " << std::setw(8) << GetPercentile(latencies, 90)
+            << "  p99 " << std::setw(8) << GetPercentile(latencies, 99)
+            << "  max " << std::setw(8) << (latencies.empty() ? 0 : *std::max_element(latencies.begin(), latencies.end())) << " us" << std::endl;
+    }
+}
+
+void WriteStatsJson(const std::vector<TransferStats>& stats, std::ostream& out)
+{
+    out << "{\n  \"transfers\": [";
+    for (std::size_t i=0; i<stats.size(); ++i)
+    {
+        const TransferStats& transfer = stats[i];
+        const uint64_t wireBytes = GetWireBytes(transfer);
+
+        out << (i == 0 ? "\n" : ",\n") << "    {\n";
+        out << "      \"port\": ";
+        WriteJsonString(transfer.port, out);
+        out << ",\n";
+        out << "      \"result\": " << transfer.result << ",\n";
+        out << "      \"totalTimeUs\": " << transfer.totalTime << ",\n";
+        out << "      \"payloadBytes\": " << transfer.payloadBytes << ",\n";
+        out << "      \"wireBytes\": " << wireBytes << ",\n";
+        out << "      \"retries\": " << transfer.retries << ",\n";
+        out << std::fixed << std::setprecision(1)
+            << "      \"effectiveBytesPerSecond\": " << GetBytesPerSecond(transfer.payloadBytes, transfer.totalTime) << ",\n"
+            << std::defaultfloat;
+
+        out << "      \"phasesUs\": {";
+        for (std::size_t p=0; p<transfer.phases.size(); ++p)
+        {
+            out << (p == 0 ? "\n" : ",\n") << "        ";
+            WriteJsonString(transfer.phases[p].first, out);
+            out << ": " << transfer.phases[p].second;
+        }
+        out << "\n      },\n";
+
+        out << "      \"commands\": {";
+        bool firstCommand = true;
+        for (const auto& command : transfer.commands)
+        {
+            const std::vector<uint32_t>& latencies = command.second.latencies;
+
+            //Bucket n counts the latencies below 2^n us (and above the previous bucket)
+            uint32_t histogram[STATS_HISTOGRAM_SIZE] = {};
+            for (uint32_t latency : latencies)
+            {
+                unsigned int bucket = 0;
+                while (bucket < STATS_HISTOGRAM_SIZE-1 && latency >= (1u<<bucket))
+                {
+                    ++bucket;
+                }
+                ++histogram[bucket];
+            }
+
+            out << (firstCommand ? "\n" : ",\n") << "        ";
+            firstCommand = false;
+            WriteJsonString(command.first, out);
+            out << ": {\n";
+            out << "          \"count\": " << command.second.count << ",\n";
+            out << "          \"sentBytes\": " << command.second.sentBytes << ",\n";
+            out << "          \"receivedBytes\": " << command.second.receivedBytes << ",\n";
+            out << "          \"latencyUs\": {\"p50\": " << GetPercentile(latencies, 50)
+                << ", \"p90\": " << GetPercentile(latencies, 90)
+                << ", \"p99\": " << GetPercentile(latencies, 99)
+                << ", \"max\": " << (latencies.empty() ? 0 : *std::max_element(latencies.begin(), latencies.end())) << "},\n";
+            out << "          \"histogram\": [";
+            for (unsigned int bucket=0; bucket<STATS_HISTOGRAM_SIZE; ++bucket)
+            {
+                out << (bucket == 0 ? "" : ", ") << histogram[bucket];
+            }
+            out << "]\n        }";
+        }
+        out << "\n      }\n    }";
+    }
+    out << "\n  ]\n}\n";
+}
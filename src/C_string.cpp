@@ -28,34 +28,147 @@ size_t Split(const std::string& str, std::vector<std::string>& buff, char delimi
    return buff.size();
 }
 
+namespace
+{
+
+//Decimal digits of every byte value, so no division is needed per digit
+struct DecimalTable
+{
+    constexpr DecimalTable() :
+        _digits()
+    {
+        for (unsigned int i=0; i<256; ++i)
+        {
+            this->_digits[i][0] = static_cast<char>('0' + i/100);
+            this->_digits[i][1] = static_cast<char>('0' + (i/10)%10);
+            this->_digits[i][2] = static_cast<char>('0' + i%10);
+        }
+    }
+
+    char _digits[256][3];
+};
+
+constexpr DecimalTable gDecimalTable;
+
+} // namespace
+
+const char* GetUint8Digits(uint8_t value)
+{
+    return gDecimalTable._digits[value];
+}
+char* WriteUint8InBuffer(uint8_t value, char* buffer)
+{
+    const char* digits = gDecimalTable._digits[value];
+    buffer[0] = digits[0];
+    buffer[1] = digits[1];
+    buffer[2] = digits[2];
+    return buffer+UINT8_STRING_SIZE;
+}
+char* WriteUint24InBuffer(uint32_t value, char* buffer)
+{
+    //8 digits written by pairs, the last 2 digits of the table entries below 100
+    for (int i=UINT24_STRING_SIZE-2; i>=0; i-=2)
+    {
+        const char* digits = gDecimalTable._digits[value%100];
+        buffer[i] = digits[1];
+        buffer[i+1] = digits[2];
+        value /= 100;
+    }
+    return buffer+UINT24_STRING_SIZE;
+}
+
 void PushUint8InString(uint8_t value, std::string& str)
 {
-    char buff;
-    buff = value/100 + '0';
-    str += buff;
-    buff = (value%100)/10 + '0';
-    str += buff;
-    buff = value%10 + '0';
-    str += buff;
+    char buffer[UINT8_STRING_SIZE];
+    str.append(buffer, WriteUint8InBuffer(value, buffer));
 }
 
 void PushUint24InString(uint32_t value, std::string& str)
 {
-    char buff;
-    buff = value/10000000 + '0';
-    str += buff;
-    buff = (value%10000000)/1000000 + '0';
-    str += buff;
-    buff = (value%1000000)/100000 + '0';
-    str += buff;
-    buff = (value%100000)/10000 + '0';
-    str += buff;
-    buff = (value%10000)/1000 + '0';
-    str += buff;
-    buff = (value%1000)/100 + '0';
-    str += buff;
-    buff = (value%100)/10 + '0';
-    str += buff;
-    buff = (value%10) + '0';
-    str += buff;
+    char buffer[UINT24_STRING_SIZE];
+    str.append(buffer, WriteUint24InBuffer(value, buffer));
+}
+
+void PushUint32HexInString(uint32_t value, std::string& str)
+{
+    const char hexDigits[] = "0123456789ABCDEF";
+    for (int shift=28; shift>=0; shift-=4)
+    {
+        str += hexDigits[(value>>shift) & 0x0F];
+    }
+}
+
+bool GetUint8FromString(const std::string& str, std::size_t pos, uint8_t& value)
+{
+    if (pos+3 > str.size())
+    {
+        return false;
+    }
+
+    unsigned int result = 0;
+    for (std::size_t i=pos; i<pos+3; ++i)
+    {
+        if (str[i] < '0' || str[i] > '9')
+        {
+            return false;
+        }
+        result = result*10 + (str[i]-'0');
+    }
+    if (result > 255)
+    {
+        return false;
+    }
+    value = static_cast<uint8_t>(result);
+    return true;
+}
+bool GetUint24FromString(const std::string& str, std::size_t pos, uint32_t& value)
+{
+    if (pos+8 > str.size())
+    {
+        return false;
+    }
+
+    uint32_t result = 0;
+    for (std::size_t i=pos; i<pos+8; ++i)
+    {
+        if (str[i] < '0' || str[i] > '9')
+        {
+            return false;
+        }
+        result = result*10 + (str[i]-'0');
+    }
+    value = result;
+    return true;
+}
+bool GetUint32FromHexString(const std::string& str, std::size_t pos, uint32_t& value)
+{
+    if (pos+8 > str.size())
+    {
+        return false;
+    }
+
+    uint32_t result = 0;
+    for (std::size_t i=pos; i<pos+8; ++i)
+    {
+        uint32_t digit;
+        if (str[i] >= '0' && str[i] <= '9')
+        {
+            digit = str[i]-'0';
+        }
+        else if (str[i] >= 'A' && str[i] <= 'F')
+        {
+            digit = str[i]-'A'+10;
+        }
+        else if (str[i] >= 'a' && str[i] <= 'f')
+        {
+            digit = str[i]-'a'+10;
+        }
+        else
+        {
+            return false;
+        }
+        result = (result<<4) | digit;
+    }
+    value = result;
+    return true;
 }
@@ -0,0 +1,693 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+#include "C_trace.hpp"
+
+#include <iomanip>
+#include <sstream>
+#include <deque>
+#include <thread>
+#include <algorithm>
+
+#include "CMakeConfig.hpp"
+
+namespace
+{
+
+uint64_t ToMicroseconds(StatsClock::duration duration)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+}
+//us to send the bytes, 10 bits per character (start, 8 data, stop)
+uint64_t GetWireMicroseconds(uint64_t size, uint32_t baudrate)
+{
+    return (baudrate == 0) ? 0 : size * 10000000 / baudrate;
+}
+
+///Unsigned LEB128, 7 bits per byte with the high bit set on every byte but the last
+void PushVarint(uint64_t value, std::string& buffer)
+{
+    while (value >= 0x80)
+    {
+        buffer += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    buffer += static_cast<char>(value);
+}
+void PushBytes(const std::string& data, std::string& buffer)
+{
+    PushVarint(data.size(), buffer);
+    buffer += data;
+}
+
+bool GetVarint(const std::string& buffer, std::size_t& pos, uint64_t& value)
+{
+    value = 0;
+    for (unsigned int shift=0; shift<64 && pos<buffer.size(); shift+=7)
+    {
+        const uint8_t byte = static_cast<uint8_t>(buffer[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+bool GetBytes(const std::string& buffer, std::size_t& pos, std::string& data)
+{
+    uint64_t size;
+    if ( !GetVarint(buffer, pos, size) || size > buffer.size()-pos )
+    {
+        return false;
+    }
+    data = buffer.substr(pos, size);
+    pos += size;
+    return true;
+}
+
+//Same names as the transfer statistics
+std::string GetCommandName(const std::string& frame)
+{
+    if (frame.compare(0, 3, "FES") == 0)
+    {
+        return "FES";
+    }
+    return frame.substr(0, 1);
+}
+
+std::string FormatDelta(uint64_t reference, uint64_t other)
+{
+    std::ostringstream delta;
+    delta << (other >= reference ? "+" : "-") << (other >= reference ? other-reference : reference-other)/1000 << " ms";
+    if (reference != 0)
+    {
+        delta << std::fixed << std::setprecision(1) << " (" << (other >= reference ? "+" : "-")
+              << static_cast<double>(other >= reference ? other-reference : reference-other) * 100.0 / static_cast<double>(reference) << "%)";
+    }
+    return delta.str();
+}
+
+} // namespace
+
+///RecordingTransport
+
+RecordingTransport::RecordingTransport(std::unique_ptr<Transport> port, const std::string& path) :
+    _g_port(std::move(port)),
+    _g_file(path, std::ios::binary | std::ios::trunc),
+    _g_origin(StatsClock::now()),
+    _g_lastStart(0)
+{
+}
+RecordingTransport::~RecordingTransport()
+{
+    if (this->_g_file.is_open())
+    {
+        this->record(TRACE_END, StatsClock::now(), std::string());
+    }
+}
+
+bool RecordingTransport::start(const std::vector<std::string>& options, const std::vector<uint8_t>& input)
+{
+    std::string header = TRACE_MAGIC;
+    PushVarint(TRACE_VERSION, header);
+    PushBytes(std::to_string(CGT_VERSION_MAJOR) + "." + std::to_string(CGT_VERSION_MINOR), header);
+    PushBytes(this->_g_port->getName(), header);
+    PushVarint(this->_g_port->getBaudrate(), header);
+    PushVarint(this->_g_port->isLineConfigurable() ? 1 : 0, header);
+    PushVarint(this->_g_port->isWireLimited() ? 1 : 0, header);
+
+    PushVarint(options.size(), header);
+    for (const std::string& option : options)
+    {
+        PushBytes(option, header);
+    }
+    PushBytes(std::string(input.begin(), input.end()), header);
+
+    this->_g_file.write(header.data(), header.size());
+    this->_g_origin = StatsClock::now();
+    return static_cast<bool>(this->_g_file);
+}
+
+void RecordingTransport::record(char type, StatsClock::time_point start, const std::string& data, uint32_t baudrate)
+{
+    const uint64_t startTime = ToMicroseconds(start - this->_g_origin);
+
+    std::string buffer(1, type);
+    PushVarint(startTime - this->_g_lastStart, buffer);
+    PushVarint(ToMicroseconds(StatsClock::now() - start), buffer);
+    if (type == TRACE_WRITE || type == TRACE_READ)
+    {
+        PushBytes(data, buffer);
+    }
+    else if (type == TRACE_BAUDRATE)
+    {
+        PushVarint(baudrate, buffer);
+    }
+
+    this->_g_lastStart = startTime;
+    this->_g_file.write(buffer.data(), buffer.size());
+}
+
+std::string RecordingTransport::getName() const
+{
+    return this->_g_port->getName();
+}
+
+std::size_t RecordingTransport::write(const std::string& data)
+{
+    const StatsClock::time_point start = StatsClock::now();
+    const std::size_t size = this->_g_port->write(data);
+    this->record(TRACE_WRITE, start, data.substr(0, size));
+    return size;
+}
+std::string RecordingTransport::read(std::size_t size)
+{
+    const StatsClock::time_point start = StatsClock::now();
+    std::string data = this->_g_port->read(size);
+    this->record(TRACE_READ, start, data);
+    return data;
+}
+std::string RecordingTransport::readLine(std::size_t maxSize)
+{
+    const StatsClock::time_point start = StatsClock::now();
+    std::string data = this->_g_port->readLine(maxSize);
+    this->record(TRACE_READ, start, data);
+    return data;
+}
+
+void RecordingTransport::flush()
+{
+    const StatsClock::time_point start = StatsClock::now();
+    this->_g_port->flush();
+    this->record(TRACE_FLUSH, start, std::string());
+}
+void RecordingTransport::flushInput()
+{
+    const StatsClock::time_point start = StatsClock::now();
+    this->_g_port->flushInput();
+    this->record(TRACE_FLUSHINPUT, start, std::string());
+}
+
+void RecordingTransport::setReadTimeout(uint32_t timeout)
+{
+    this->_g_port->setReadTimeout(timeout);
+}
+
+bool RecordingTransport::isLineConfigurable() const
+{
+    return this->_g_port->isLineConfigurable();
+}
+bool RecordingTransport::isWireLimited() const
+{
+    return this->_g_port->isWireLimited();
+}
+uint32_t RecordingTransport::getBaudrate() const
+{
+    return this->_g_port->getBaudrate();
+}
+void RecordingTransport::setBaudrate(uint32_t baudrate)
+{
+    const StatsClock::time_point start = StatsClock::now();
+    this->_g_port->setBaudrate(baudrate);
+    this->record(TRACE_BAUDRATE, start, std::string(), baudrate);
+}
+void RecordingTransport::setHardwareFlowControl(bool enabled)
+{
+    this->_g_port->setHardwareFlowControl(enabled);
+}
+
+///ReplayTransport
+
+ReplayTransport::ReplayTransport(const Trace& trace, double timeScale) :
+    _g_nextReply(0),
+    _g_nextGate(0),
+    _g_writtenSize(0),
+    _g_flushCount(0),
+    _g_diverged(false),
+    _g_divergenceOffset(0),
+    _g_waitTime(0),
+    _g_timeScale(timeScale),
+    _g_baudrate(trace.baudrate),
+    _g_lineConfigurable(trace.lineConfigurable),
+    _g_wireLimited(trace.wireLimited)
+{
+    uint32_t baudrate = trace.wireLimited ? trace.baudrate : 0;
+    uint64_t gateTime = 0; //End of the last write or input flush
+
+    for (const TraceEvent& event : trace.events)
+    {
+        const uint64_t end = event.start + event.duration;
+
+        switch (event.type)
+        {
+        case TRACE_WRITE:
+            this->_g_written += event.data;
+            gateTime = end;
+            break;
+        case TRACE_FLUSHINPUT:
+            ++this->_g_flushCount;
+            gateTime = end;
+            break;
+        case TRACE_BAUDRATE:
+            baudrate = trace.wireLimited ? event.baudrate : 0;
+            break;
+        case TRACE_READ:
+            if ( !event.data.empty() )
+            {
+                //A read that didn't wait got data received earlier, while the host was busy
+                uint64_t arrival = end;
+                if (event.duration < TRACE_BLOCKED_TIME)
+                {
+                    arrival = std::min(end, gateTime + GetWireMicroseconds(event.data.size(), baudrate));
+                }
+
+                Reply reply;
+                reply.data = event.data;
+                reply.writtenSize = this->_g_written.size();
+                reply.flushCount = this->_g_flushCount;
+                reply.delay = arrival > gateTime ? arrival-gateTime : 0;
+                this->_g_replies.push_back(std::move(reply));
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    this->_g_flushCount = 0;
+    this->openGates();
+}
+
+void ReplayTransport::openGates()
+{
+    const StatsClock::time_point now = StatsClock::now();
+
+    while ( this->_g_nextGate < this->_g_replies.size() &&
+            this->_g_replies[this->_g_nextGate].writtenSize <= this->_g_writtenSize &&
+            this->_g_replies[this->_g_nextGate].flushCount <= this->_g_flushCount )
+    {
+        Reply& reply = this->_g_replies[this->_g_nextGate++];
+        reply.gated = true;
+        reply.availableTime = now + std::chrono::microseconds(static_cast<uint64_t>(static_cast<double>(reply.delay) * this->_g_timeScale));
+    }
+}
+void ReplayTransport::receive(std::size_t size, bool line)
+{
+    for (;;)
+    {
+        const StatsClock::time_point now = StatsClock::now();
+        while ( this->_g_nextReply < this->_g_nextGate && this->_g_replies[this->_g_nextReply].availableTime <= now )
+        {
+            this->_g_buffer += this->_g_replies[this->_g_nextReply++].data;
+        }
+
+        if ( this->_g_buffer.size() >= size || (line && this->_g_buffer.find('\n') != std::string::npos) )
+        {
+            return;
+        }
+        if (this->_g_nextReply >= this->_g_nextGate)
+        {
+            //Nothing else comes until the host writes
+            return;
+        }
+
+        const StatsClock::time_point availableTime = this->_g_replies[this->_g_nextReply].availableTime;
+        std::this_thread::sleep_until(availableTime);
+        this->_g_waitTime += ToMicroseconds(StatsClock::now() - now);
+    }
+}
+
+std::string ReplayTransport::getName() const
+{
+    return "replay";
+}
+
+std::size_t ReplayTransport::write(const std::string& data)
+{
+    if (!this->_g_diverged)
+    {
+        const std::size_t size = std::min<std::size_t>(data.size(), this->_g_written.size() - std::min<uint64_t>(this->_g_writtenSize, this->_g_written.size()));
+        const auto mismatch = std::mismatch(data.begin(), data.begin()+size, this->_g_written.begin()+this->_g_writtenSize);
+        if (mismatch.first != data.begin()+size || size != data.size())
+        {
+            this->_g_diverged = true;
+            this->_g_divergenceOffset = this->_g_writtenSize + (mismatch.first - data.begin());
+        }
+    }
+
+    this->_g_writtenSize += data.size();
+    this->openGates();
+    return data.size();
+}
+std::string ReplayTransport::read(std::size_t size)
+{
+    this->receive(size, false);
+
+    std::string data = this->_g_buffer.substr(0, size);
+    this->_g_buffer.erase(0, data.size());
+    return data;
+}
+std::string ReplayTransport::readLine(std::size_t maxSize)
+{
+    this->receive(maxSize, true);
+
+    const std::size_t end = this->_g_buffer.find('\n');
+    std::string data = this->_g_buffer.substr(0, (end == std::string::npos) ? maxSize : std::min(end+1, maxSize));
+    this->_g_buffer.erase(0, data.size());
+    return data;
+}
+
+void ReplayTransport::flush()
+{
+}
+void ReplayTransport::flushInput()
+{
+    //The replies before the recorded flush were dropped with it
+    ++this->_g_flushCount;
+    this->_g_buffer.clear();
+    while ( this->_g_nextReply < this->_g_replies.size() && this->_g_replies[this->_g_nextReply].flushCount < this->_g_flushCount )
+    {
+        ++this->_g_nextReply;
+    }
+    this->_g_nextGate = std::max(this->_g_nextGate, this->_g_nextReply);
+    this->openGates();
+}
+
+void ReplayTransport::setReadTimeout(uint32_t)
+{
+    //The replies come from the trace, a missing one is never waited for
+}
+
+bool ReplayTransport::isLineConfigurable() const
+{
+    return this->_g_lineConfigurable;
+}
+bool ReplayTransport::isWireLimited() const
+{
+    return this->_g_wireLimited;
+}
+uint32_t ReplayTransport::getBaudrate() const
+{
+    return this->_g_baudrate;
+}
+void ReplayTransport::setBaudrate(uint32_t baudrate)
+{
+    this->_g_baudrate = baudrate;
+}
+void ReplayTransport::setHardwareFlowControl(bool)
+{
+}
+
+bool ReplayTransport::isDiverged() const
+{
+    return this->_g_diverged;
+}
+uint64_t ReplayTransport::getDivergenceOffset() const
+{
+    return this->_g_divergenceOffset;
+}
+uint64_t ReplayTransport::getWaitTime() const
+{
+    return this->_g_waitTime;
+}
+
+///Trace file
+
+bool LoadTrace(const std::string& path, Trace& trace, std::ostream& log)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        log << "Can't open the trace \"" << path << "\" !" << std::endl;
+        return false;
+    }
+    std::ostringstream content;
+    content << file.rdbuf();
+    const std::string buffer = content.str();
+
+    trace = Trace();
+
+    const std::string magic = TRACE_MAGIC;
+    std::size_t pos = magic.size();
+    uint64_t version;
+    if ( buffer.compare(0, magic.size(), magic) != 0 || !GetVarint(buffer, pos, version) )
+    {
+        log << "\"" << path << "\" is not a trace !" << std::endl;
+        return false;
+    }
+    if (version != TRACE_VERSION)
+    {
+        log << "Unsupported trace version " << version << " !" << std::endl;
+        return false;
+    }
+
+    uint64_t baudrate;
+    uint64_t lineConfigurable;
+    uint64_t wireLimited;
+    uint64_t optionCount;
+    std::string input;
+    bool success = GetBytes(buffer, pos, trace.version) && GetBytes(buffer, pos, trace.portName) &&
+                   GetVarint(buffer, pos, baudrate) && GetVarint(buffer, pos, lineConfigurable) && GetVarint(buffer, pos, wireLimited) &&
+                   GetVarint(buffer, pos, optionCount);
+    for (uint64_t i=0; success && i<optionCount; ++i)
+    {
+        trace.options.emplace_back();
+        success = GetBytes(buffer, pos, trace.options.back());
+    }
+    success = success && GetBytes(buffer, pos, input);
+    if (!success)
+    {
+        log << "The header of the trace \"" << path << "\" is corrupted !" << std::endl;
+        return false;
+    }
+    trace.baudrate = static_cast<uint32_t>(baudrate);
+    trace.lineConfigurable = (lineConfigurable != 0);
+    trace.wireLimited = (wireLimited != 0);
+    trace.input.assign(input.begin(), input.end());
+
+    //A trace cut by a crash is used up to its last complete record
+    uint64_t start = 0;
+    while (pos < buffer.size())
+    {
+        TraceEvent event;
+        event.type = buffer[pos++];
+
+        uint64_t delta;
+        uint64_t value = 0;
+        success = GetVarint(buffer, pos, delta) && GetVarint(buffer, pos, event.duration);
+        if (event.type == TRACE_WRITE || event.type == TRACE_READ)
+        {
+            success = success && GetBytes(buffer, pos, event.data);
+        }
+        else if (event.type == TRACE_BAUDRATE)
+        {
+            success = success && GetVarint(buffer, pos, value);
+        }
+        else if (event.type != TRACE_FLUSH && event.type != TRACE_FLUSHINPUT && event.type != TRACE_END)
+        {
+            success = false;
+        }
+        if (!success)
+        {
+            log << "The trace \"" << path << "\" is truncated or corrupted, " << trace.events.size() << " event(s) kept" << std::endl;
+            break;
+        }
+
+        start += delta;
+        event.start = start;
+        event.baudrate = static_cast<uint32_t>(value);
+        if (event.type == TRACE_END)
+        {
+            break;
+        }
+        trace.events.push_back(std::move(event));
+    }
+    return true;
+}
+
+///Analysis
+
+void AnalyseTrace(const Trace& trace, TraceReport& report)
+{
+    struct PendingCommand
+    {
+        std::string name;
+        uint64_t written; //Start of the write
+        uint64_t received; //End of the command on the wire
+    };
+    std::deque<PendingCommand> pending;
+
+    report = TraceReport();
+
+    //No wire time without a line (loopback)
+    uint32_t baudrate = trace.wireLimited ? trace.baudrate : 0;
+    bool inFrame = false;
+    std::string frame;
+    uint64_t wireEnd = 0; //Of the last sent byte
+    uint64_t lineSize = 0;
+    uint64_t lastReply = 0;
+
+    for (const TraceEvent& event : trace.events)
+    {
+        const uint64_t end = event.start + event.duration;
+        report.total = std::max(report.total, end);
+
+        switch (event.type)
+        {
+        case TRACE_WRITE:
+            report.wait += event.duration;
+            report.sentBytes += event.data.size();
+            report.wireSent += GetWireMicroseconds(event.data.size(), baudrate);
+            wireEnd = std::max(wireEnd, event.start) + GetWireMicroseconds(event.data.size(), baudrate);
+
+            for (char c : event.data)
+            {
+                if (!inFrame)
+                {
+                    inFrame = (c == '$');
+                    frame.clear();
+                }
+                else if (c == '#')
+                {
+                    inFrame = false;
+                    pending.push_back(PendingCommand{GetCommandName(frame), event.start, wireEnd});
+                }
+                else if (frame.size() < 3)
+                {
+                    frame += c;
+                }
+            }
+            break;
+
+        case TRACE_READ:
+            report.wait += event.duration;
+            report.receivedBytes += event.data.size();
+            report.wireReceived += GetWireMicroseconds(event.data.size(), baudrate);
+            if (event.data.empty())
+            {
+                ++report.timeouts;
+            }
+
+            for (char c : event.data)
+            {
+                ++lineSize;
+                if (c != '\n')
+                {
+                    continue;
+                }
+
+                //The board answers in order, it starts a command once received and once the previous reply is sent
+                if ( !pending.empty() )
+                {
+                    const PendingCommand& command = pending.front();
+                    const uint64_t boardStart = std::max(command.received, lastReply) + GetWireMicroseconds(lineSize, baudrate);
+                    const uint64_t boardTime = (end > boardStart) ? end-boardStart : 0;
+
+                    TraceCommandReport& commandReport = report.commands[command.name];
+                    commandReport.turnarounds.push_back(static_cast<uint32_t>(end - std::min(end, command.written)));
+                    commandReport.boardTimes.push_back(static_cast<uint32_t>(boardTime));
+                    report.board += boardTime;
+                    pending.pop_front();
+                }
+                lastReply = end;
+                lineSize = 0;
+            }
+            break;
+
+        case TRACE_FLUSHINPUT:
+            //Every reply in flight is dropped
+            report.wait += event.duration;
+            pending.clear();
+            lineSize = 0;
+            break;
+
+        case TRACE_FLUSH:
+            report.wait += event.duration;
+            break;
+
+        case TRACE_BAUDRATE:
+            baudrate = trace.wireLimited ? event.baudrate : 0;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    report.host = (report.total > report.wait) ? report.total-report.wait : 0;
+}
+
+void PrintTraceReport(const TraceReport& report, std::ostream& out)
+{
+    out << "\ttotal        " << std::setw(10) << report.total/1000 << " ms" << std::endl;
+    out << "\thost         " << std::setw(10) << report.host/1000 << " ms (between the port calls)" << std::endl;
+    out << "\twaiting      " << std::setw(10) << report.wait/1000 << " ms (in the port calls, " << report.timeouts << " timeout(s))" << std::endl;
+    out << "\twire sent    " << std::setw(10) << report.wireSent/1000 << " ms (" << report.sentBytes << " byte(s))" << std::endl;
+    out << "\twire received" << std::setw(10) << report.wireReceived/1000 << " ms (" << report.receivedBytes << " byte(s))" << std::endl;
+    out << "\tboard        " << std::setw(10) << report.board/1000 << " ms" << std::endl;
+
+    for (const auto& command : report.commands)
+    {
+        out << "\t$" << std::left << std::setw(11) << command.first << std::right
+            << std::setw(8) << command.second.turnarounds.size() << " command(s)"
+            << "  turnaround p50 " << std::setw(8) << GetPercentile(command.second.turnarounds, 50)
+            << "  p90 " << std::setw(8) << GetPercentile(command.second.turnarounds, 90)
+            << "  board p50 " << std::setw(8) << GetPercentile(command.second.boardTimes, 50)
+            << "  p90 " << std::setw(8) << GetPercentile(command.second.boardTimes, 90) << " us" << std::endl;
+    }
+}
+
+void PrintTraceComparison(const TraceReport& reference, const TraceReport& other, std::ostream& out)
+{
+    const std::pair<const char*, uint64_t TraceReport::*> times[] = {
+        {"total", &TraceReport::total},
+        {"host", &TraceReport::host},
+        {"waiting", &TraceReport::wait},
+        {"wire sent", &TraceReport::wireSent},
+        {"wire received", &TraceReport::wireReceived},
+        {"board", &TraceReport::board}
+    };
+
+    for (const auto& time : times)
+    {
+        out << "\t" << std::left << std::setw(13) << time.first << std::right
+            << std::setw(10) << reference.*time.second/1000 << " ms"
+            << std::setw(10) << other.*time.second/1000 << " ms  "
+            << FormatDelta(reference.*time.second, other.*time.second) << std::endl;
+    }
+
+    for (const auto& command : reference.commands)
+    {
+        const auto otherCommand = other.commands.find(command.first);
+        if (otherCommand == other.commands.end())
+        {
+            out << "\t$" << std::left << std::setw(11) << command.first << std::right << " only in the reference" << std::endl;
+            continue;
+        }
+        out << "\t$" << std::left << std::setw(11) << command.first << std::right
+            << "  turnaround p50 " << std::setw(8) << GetPercentile(command.second.turnarounds, 50)
+            << " -> " << std::setw(8) << GetPercentile(otherCommand->second.turnarounds, 50)
+            << "  board p50 " << std::setw(8) << GetPercentile(command.second.boardTimes, 50)
+            << " -> " << std::setw(8) << GetPercentile(otherCommand->second.boardTimes, 50) << " us" << std::endl;
+    }
+    for (const auto& command : other.commands)
+    {
+        if (reference.commands.find(command.first) == reference.commands.end())
+        {
+            out << "\t$" << std::left << std::setw(11) << command.first << std::right << " only in the other" << std::endl;
+        }
+    }
+}
@@ -0,0 +1,1573 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "C_transfer.hpp"
+
+#include <deque>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+
+#include "C_string.hpp"
+#include "C_checksum.hpp"
+#include "C_frame.hpp"
+#include "C_board.hpp"
+#include "C_manifest.hpp"
+#include "C_journal.hpp"
+#include "C_range.hpp"
+#include "C_encoder.hpp"
+
+uint32_t GetWireTime(const Transport& port, std::size_t size)
+{
+    //10 bits per character (start, 8 data, stop)
+    return static_cast<uint32_t>(static_cast<uint64_t>(size) * 10000 / port.getBaudrate()) + 1;
+}
+void SetReplyTimeout(Transport& port, uint32_t timeout)
+{
+    port.setReadTimeout(timeout);
+}
+std::string ReadReply(Transport& port, uint32_t timeout, std::size_t maxSize)
+{
+    SetReplyTimeout(port, timeout + GetWireTime(port, maxSize));
+    return port.readLine(maxSize);
+}
+
+bool ReadAtLeast(Transport& port, std::string& buffer, std::size_t& pos, std::size_t size, uint32_t timeout)
+{
+    if (buffer.size()-pos >= size)
+    {
+        return true;
+    }
+
+    buffer.erase(0, pos);
+    pos = 0;
+    SetReplyTimeout(port, timeout + GetWireTime(port, size - buffer.size()));
+    buffer += port.read(size - buffer.size());
+    return buffer.size() >= size;
+}
+bool ReadEncodedUint8(Transport& port, std::string& buffer, std::size_t& pos, uint8_t encoding, std::size_t minRemaining, uint8_t& value)
+{
+    uint8_t result;
+    while ( (result = DecodeUint8(buffer, pos, encoding, value)) == DECODE_INCOMPLETE )
+    {
+        //Never ask for more than what is left in the reply, so nothing is read past it
+        std::size_t available = buffer.size()-pos;
+        std::size_t wanted = std::min<std::size_t>(minRemaining, READ_STREAM_SIZE*3);
+        if ( !ReadAtLeast(port, buffer, pos, std::max(available+1, wanted)) )
+        {
+            return false;
+        }
+    }
+    return result == DECODE_OK;
+}
+
+namespace
+{
+
+//Reply of a $R command already sent, the data is decoded into the output when there is one, else given to the callback
+bool ReceiveRange(Transport& port, uint32_t address, uint32_t numOfData, uint8_t encoding, uint8_t checksumType, uint8_t* output, const ReadRangeCallback& callback,
+                  std::ostream& log, TransferStats* stats, std::size_t transmitSize, StatsClock::time_point sent)
+{
+    std::string receiveBuffer;
+    std::size_t receivePos = 0;
+    uint8_t streamBuffer[READ_STREAM_SIZE];
+
+    ///Header, the board can send the whole reply at once
+    if ( !ReadAtLeast(port, receiveBuffer, receivePos, FRAME_READHEADER_SIZE, REPLY_TIMEOUT + GetWireTime(port, GetEncodedMaxSize(numOfData, encoding))) )
+    {
+        log << std::endl << "The board didn't respond !" << std::endl;
+        return false;
+    }
+    receivePos += FRAME_READHEADER_SIZE;
+
+    const uint8_t checksumSize = GetChecksumSize(checksumType);
+    uint8_t boardChecksum[MAX_CHECKSUM_SIZE];
+    for (uint8_t i=0; i<checksumSize; ++i)
+    {
+        if ( !ReadEncodedUint8(port, receiveBuffer, receivePos, encoding, GetEncodedMinSize(checksumSize-i, encoding)+8, boardChecksum[i]) )
+        {
+            log << std::endl << "The board sent a bad response !" << std::endl;
+            return false;
+        }
+    }
+
+    uint32_t boardAddress;
+    if ( !ReadAtLeast(port, receiveBuffer, receivePos, 8) ||
+         !GetUint24FromString(receiveBuffer, receivePos, boardAddress) )
+    {
+        log << std::endl << "The board sent a bad response !" << std::endl;
+        return false;
+    }
+    receivePos += 8;
+
+    if (boardAddress != address)
+    {
+        log << std::endl << "The board returned a bad address " << boardAddress << " !" << std::endl;
+        return false;
+    }
+
+    ///Data, given to the callback as it comes in
+    std::size_t receivedSize = FRAME_READHEADER_SIZE + GetEncodedSize(boardChecksum, checksumSize, encoding) + UINT24_STRING_SIZE + 1;
+    uint8_t sum = 0;
+    uint32_t crc = CRC32_INIT;
+    uint32_t numOfDataLeft = numOfData;
+    while (numOfDataLeft > 0)
+    {
+        uint32_t streamSize = std::min<uint32_t>(READ_STREAM_SIZE, numOfDataLeft);
+        uint8_t* streamData = (output != nullptr) ? output + (numOfData-numOfDataLeft) : streamBuffer;
+
+        for (uint32_t i=0; i<streamSize; ++i)
+        {
+            if ( !ReadEncodedUint8(port, receiveBuffer, receivePos, encoding, GetEncodedMinSize(numOfDataLeft-i, encoding), streamData[i]) )
+            {
+                log << std::endl << "The board didn't respond or sent a bad response !" << std::endl;
+                return false;
+            }
+            sum += streamData[i];
+        }
+        if (checksumType == CHECKSUM_CRC32)
+        {
+            crc = UpdateCrc32(crc, streamData, streamSize);
+        }
+        if (stats != nullptr)
+        {
+            receivedSize += GetEncodedSize(streamData, streamSize, encoding);
+        }
+
+        if ( callback && !callback(address + numOfData-numOfDataLeft, streamData, streamSize) )
+        {
+            return false;
+        }
+
+        numOfDataLeft -= streamSize;
+    }
+
+    ///Terminator
+    bool validChecksum;
+    if (checksumType == CHECKSUM_CRC32)
+    {
+        crc = FinalizeCrc32(crc);
+        validChecksum = boardChecksum[0] == static_cast<uint8_t>(crc>>24) && boardChecksum[1] == static_cast<uint8_t>(crc>>16) &&
+                        boardChecksum[2] == static_cast<uint8_t>(crc>>8) && boardChecksum[3] == static_cast<uint8_t>(crc);
+    }
+    else
+    {
+        validChecksum = (sum == boardChecksum[0]);
+    }
+
+    if ( !ReadAtLeast(port, receiveBuffer, receivePos, 1) || !validChecksum )
+    {
+        log << std::endl << "The board sent a bad response !" << std::endl;
+        return false;
+    }
+
+    RecordCommand(stats, "R", transmitSize, receivedSize, sent);
+    return true;
+}
+
+} // namespace
+
+bool ReadRange(Transport& port, uint32_t address, uint32_t numOfData, uint8_t encoding, uint8_t checksumType, const ReadRangeCallback& callback, std::ostream& log, TransferStats* stats)
+{
+    std::string transmitBuffer;
+
+    BuildReadFrame(address, numOfData, transmitBuffer);
+    const StatsClock::time_point sent = StatsClock::now();
+    port.write(transmitBuffer);
+
+    return ReceiveRange(port, address, numOfData, encoding, checksumType, nullptr, callback, log, stats, transmitBuffer.size(), sent);
+}
+bool DumpRange(Transport& port, uint8_t* data, uint32_t address, uint32_t size, const TransferSettings& settings, const BoardSession& session, std::ostream& log, TransferStats* stats)
+{
+    const uint32_t firstAddress = address;
+    const uint64_t endAddress = static_cast<uint64_t>(address) + size;
+    const uint32_t blockSize = settings.dumpBlockSize;
+
+    std::string transmitBuffer;
+    std::deque<StatsClock::time_point> requests; //Sent time of the requests in flight, from the read address
+    uint32_t requestAddress = address;
+
+    unsigned int retries = 0; //of the oldest request
+    unsigned int lastPercent = 100;
+
+    while (address < endAddress)
+    {
+        ///Filling the window, the board queues the requests and the replies come in order
+        while ( requests.size() < settings.windowSize && requestAddress < endAddress )
+        {
+            BuildReadFrame(requestAddress, static_cast<uint32_t>(std::min<uint64_t>(blockSize, endAddress-requestAddress)), transmitBuffer);
+            requests.push_back(StatsClock::now());
+            port.write(transmitBuffer);
+            requestAddress += static_cast<uint32_t>(std::min<uint64_t>(blockSize, endAddress-requestAddress));
+        }
+
+        //Every 10% in quiet mode
+        const unsigned int percent = (static_cast<uint64_t>(address-firstAddress)*100)/size;
+        if (!settings.quiet || percent/10 != lastPercent/10)
+        {
+            log << percent << "% done ..." << std::endl;
+            lastPercent = percent;
+        }
+
+        const uint32_t numOfData = static_cast<uint32_t>(std::min<uint64_t>(blockSize, endAddress-address));
+        if ( ReceiveRange(port, address, numOfData, session.encoding, session.checksumType, data + (address-firstAddress), ReadRangeCallback(),
+                          log, stats, transmitBuffer.size(), requests.front()) )
+        {
+            retries = 0;
+            requests.pop_front();
+            address += numOfData;
+            continue;
+        }
+
+        ///Requesting every block in flight again, from the failed one
+        do
+        {
+            if (retries >= settings.retryCount)
+            {
+                return false;
+            }
+            ++retries;
+            if (stats != nullptr)
+            {
+                ++stats->retries;
+            }
+
+            log << "Retrying from address " << address << " (" << retries << "/" << settings.retryCount << ") ..." << std::endl;
+        }
+        while ( !Resync(port) );
+
+        requests.clear();
+        requestAddress = address;
+    }
+
+    log << "100% done ..." << std::endl;
+    return true;
+}
+
+bool VerifyRange(Transport& port, const uint8_t* data, uint32_t address, uint32_t size, uint32_t blockSize, uint8_t encoding, uint8_t checksumType, std::ostream& log, TransferStats* stats)
+{
+    const uint32_t firstAddress = address;
+    const uint32_t endAddress = address + size;
+
+    while (address < endAddress)
+    {
+        uint32_t numOfData = std::min(blockSize, endAddress-address);
+
+        log << "Verifying " << numOfData << " byte(s) at address " << address << " ... ";
+
+        bool success = ReadRange(port, address, numOfData, encoding, checksumType, [&](uint32_t readAddress, const uint8_t* readData, uint32_t readSize){
+            const uint8_t* expectedData = data + (readAddress-firstAddress);
+            for (uint32_t i=0; i<readSize; ++i)
+            {
+                if (readData[i] != expectedData[i])
+                {
+                    log << std::endl << "Mismatch at address " << (readAddress+i)
+                              << " : expected " << static_cast<unsigned int>(expectedData[i])
+                              << ", read " << static_cast<unsigned int>(readData[i]) << " !" << std::endl;
+                    return false;
+                }
+            }
+            return true;
+        }, log, stats);
+        if (!success)
+        {
+            return false;
+        }
+
+        log << "OK" << std::endl;
+        address += numOfData;
+    }
+
+    return true;
+}
+bool CompareRange(Transport& port, const uint8_t* data, uint32_t address, uint32_t size, uint32_t blockSize, uint8_t encoding, uint8_t checksumType, bool& identical, std::ostream& log, TransferStats* stats)
+{
+    const uint32_t firstAddress = address;
+    const uint32_t endAddress = address + size;
+
+    identical = true;
+
+    while (address < endAddress)
+    {
+        uint32_t numOfData = std::min(blockSize, endAddress-address);
+
+        //The whole reply is always read, so the board stays in sync
+        bool success = ReadRange(port, address, numOfData, encoding, checksumType, [&](uint32_t readAddress, const uint8_t* readData, uint32_t readSize){
+            identical = identical && std::equal(readData, readData+readSize, data + (readAddress-firstAddress));
+            return true;
+        }, log, stats);
+        if (!success)
+        {
+            return false;
+        }
+
+        address += numOfData;
+    }
+
+    return true;
+}
+
+bool ReadRangeCrc(Transport& port, uint32_t address, uint32_t numOfData, uint32_t& crc, std::ostream& log, TransferStats* stats)
+{
+    std::string transmitBuffer;
+    std::string receiveBuffer;
+
+    BuildRangeCrcFrame(address, numOfData, transmitBuffer);
+    const StatsClock::time_point sent = StatsClock::now();
+    port.write(transmitBuffer);
+    SetReplyTimeout(port, REPLY_TIMEOUT + GetWireTime(port, FRAME_CRC_SIZE) + (numOfData/1024)*RANGE_TIMEOUT);
+    receiveBuffer = port.read(FRAME_CRC_SIZE);
+
+    if ( !GetRangeCrc(receiveBuffer, crc) )
+    {
+        log << std::endl << "The board didn't respond or sent a bad response !" << std::endl;
+        return false;
+    }
+
+    RecordCommand(stats, "C", transmitBuffer.size(), receiveBuffer.size(), sent);
+    return true;
+}
+bool VerifyRangeCrc(Transport& port, const uint8_t* data, uint32_t address, uint32_t size, uint32_t blockSize, uint8_t encoding, uint8_t checksumType, std::ostream& log, TransferStats* stats)
+{
+    const uint32_t firstAddress = address;
+    const uint32_t endAddress = address + size;
+
+    while (address < endAddress)
+    {
+        uint32_t numOfData = std::min<uint32_t>(MAX_CRCSIZE, endAddress-address);
+        const uint8_t* expectedData = data + (address-firstAddress);
+
+        log << "Verifying the CRC of " << numOfData << " byte(s) at address " << address << " ... ";
+
+        uint32_t crc;
+        if ( !ReadRangeCrc(port, address, numOfData, crc, log, stats) )
+        {
+            return false;
+        }
+
+        if ( crc != CalculateCrc32(expectedData, numOfData) )
+        {
+            //Read back the range to find the mismatch
+            log << "mismatch" << std::endl;
+            VerifyRange(port, expectedData, address, numOfData, blockSize, encoding, checksumType, log, stats);
+            return false;
+        }
+
+        log << "OK" << std::endl;
+        address += numOfData;
+    }
+
+    return true;
+}
+bool CompareRangeCrc(Transport& port, const uint8_t* data, uint32_t address, uint32_t size, bool& identical, std::ostream& log, TransferStats* stats)
+{
+    const uint32_t firstAddress = address;
+    const uint32_t endAddress = address + size;
+
+    identical = true;
+
+    while (address < endAddress)
+    {
+        uint32_t numOfData = std::min<uint32_t>(MAX_CRCSIZE, endAddress-address);
+
+        uint32_t crc;
+        if ( !ReadRangeCrc(port, address, numOfData, crc, log, stats) )
+        {
+            return false;
+        }
+        identical = identical && (crc == CalculateCrc32(data + (address-firstAddress), numOfData));
+
+        address += numOfData;
+    }
+
+    return true;
+}
+
+bool BlankCheckRange(Transport& port, uint32_t address, uint32_t size, std::ostream& log, TransferStats* stats)
+{
+    std::string transmitBuffer;
+    std::string receiveBuffer;
+
+    const uint32_t endAddress = address + size;
+
+    while (address < endAddress)
+    {
+        uint32_t numOfData = std::min<uint32_t>(MAX_BLANKCHECKSIZE, endAddress-address);
+
+        log << "Blank checking " << numOfData << " byte(s) at address " << address << " ... ";
+
+        BuildBlankCheckFrame(address, numOfData, transmitBuffer);
+        const StatsClock::time_point sent = StatsClock::now();
+        port.write(transmitBuffer);
+        receiveBuffer = ReadReply(port, REPLY_TIMEOUT + (numOfData/1024)*RANGE_TIMEOUT);
+        RecordCommand(stats, "K", transmitBuffer.size(), receiveBuffer.size(), sent);
+
+        log << receiveBuffer;
+        if (receiveBuffer != "BLANK\n")
+        {
+            uint32_t failedAddress;
+            if ( receiveBuffer.compare(0, 8, "NOTBLANK") == 0 && GetUint24FromString(receiveBuffer, 8, failedAddress) )
+            {
+                log << "Address " << failedAddress << " is not blank !" << std::endl;
+            }
+            else
+            {
+                log << std::endl << "The board didn't respond or sent a bad response !" << std::endl;
+            }
+            return false;
+        }
+
+        address += numOfData;
+    }
+
+    return true;
+}
+
+bool SayHello(Transport& port)
+{
+    port.write("$H#");
+    return ReadReply(port, REPLY_TIMEOUT) == "HELLO\n";
+}
+bool ProbeBoard(Transport& port, uint32_t timeout, std::string* information)
+{
+    //The port can be anything, the '#' ends what the device may have partially received
+    port.flushInput();
+    port.write("#$H#");
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    bool hello = false;
+    while (!hello)
+    {
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0)
+        {
+            return false;
+        }
+
+        SetReplyTimeout(port, static_cast<uint32_t>(remaining));
+        const std::string reply = port.readLine(MAX_REPLYSIZE);
+        if (reply.empty())
+        {
+            return false;
+        }
+        hello = (reply == "HELLO\n");
+    }
+
+    if (information != nullptr)
+    {
+        port.write("$I#");
+        *information = ReadReply(port, timeout, MAX_INFOSIZE);
+        if (information->empty() || information->back() != '\n')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+bool Resync(Transport& port)
+{
+    //A '#' ends a frame the board may have partially received, every reply before the hello is dropped
+    port.flushInput();
+    port.write("#$H#");
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(RESYNC_TIMEOUT);
+    do
+    {
+        const std::string reply = ReadReply(port, REPLY_TIMEOUT);
+        if (reply == "HELLO\n")
+        {
+            return true;
+        }
+        if (reply.empty())
+        {
+            return false;
+        }
+    }
+    while (std::chrono::steady_clock::now() < deadline);
+
+    return false;
+}
+bool NegotiateBaudrate(Transport& port, const std::string& information, uint32_t targetBaudrate, bool hardwareFlowControl, std::ostream& log)
+{
+    std::string transmitBuffer;
+    std::string receiveBuffer;
+
+    std::vector<uint32_t> baudrates;
+    GetBoardBaudrates(information, baudrates);
+
+    //Keep the advertised rates up to the target, the current rate is the last resort
+    baudrates.erase(std::remove_if(baudrates.begin(), baudrates.end(), [&](uint32_t baudrate){
+        return baudrate > targetBaudrate || baudrate <= port.getBaudrate();
+    }), baudrates.end());
+    if (hardwareFlowControl)
+    {
+        baudrates.push_back(port.getBaudrate());
+    }
+
+    const uint32_t previousBaudrate = port.getBaudrate();
+
+    for (uint32_t baudrate : baudrates)
+    {
+        log << "Switching to " << baudrate << " baud" << (hardwareFlowControl ? " with RTS/CTS" : "") << " ... ";
+
+        BuildBaudrateFrame(baudrate, hardwareFlowControl, transmitBuffer);
+        port.write(transmitBuffer);
+        port.flush();
+        receiveBuffer = ReadReply(port, REPLY_TIMEOUT);
+
+        if (receiveBuffer != transmitBuffer.substr(1, 9) + '\n')
+        {
+            log << "refused" << std::endl;
+            continue;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(BAUDRATE_SETTLE_DELAY));
+        port.setBaudrate(baudrate);
+        port.setHardwareFlowControl(hardwareFlowControl);
+        port.flushInput();
+
+        if ( SayHello(port) )
+        {
+            log << "HELLO" << std::endl;
+            return true;
+        }
+
+        //The board is going back to the previous rate by itself
+        log << "no response, stepping down" << std::endl;
+
+        port.setBaudrate(previousBaudrate);
+        port.setHardwareFlowControl(false);
+        std::this_thread::sleep_for(std::chrono::milliseconds(BAUDRATE_FALLBACK_DELAY));
+        port.flushInput();
+
+        if ( !SayHello(port) )
+        {
+            log << "The board didn't come back at " << previousBaudrate << " baud !" << std::endl;
+            return false;
+        }
+    }
+
+    log << "Staying at " << port.getBaudrate() << " baud" << std::endl;
+    return !hardwareFlowControl;
+}
+
+bool OpenSession(Transport& port, const TransferSettings& settings, BoardSession& session, std::ostream& log, TransferStats* stats)
+{
+    std::string transmitBuffer;
+    std::string receiveBuffer;
+
+    uint8_t encoding = settings.encoding;
+    uint8_t checksumType = settings.checksumType;
+
+    StatsClock::time_point phaseStart = StatsClock::now();
+    StatsClock::time_point sent;
+
+    log << "Saying hello ... ";
+
+    sent = StatsClock::now();
+    port.write("$H#");
+    receiveBuffer = ReadReply(port, REPLY_TIMEOUT);
+    RecordCommand(stats, "H", 3, receiveBuffer.size(), sent);
+
+    log << receiveBuffer << std::endl;
+    if (receiveBuffer != "HELLO\n")
+    {
+        log << "The board didn't respond or sent a bad response !" << std::endl;
+        return false;
+    }
+    EndPhase(stats, "hello", phaseStart);
+
+    log << "Get board information ... ";
+
+    sent = StatsClock::now();
+    port.write("$I#");
+    receiveBuffer = ReadReply(port, REPLY_TIMEOUT, MAX_INFOSIZE);
+    RecordCommand(stats, "I", 3, receiveBuffer.size(), sent);
+
+    log << std::endl << receiveBuffer << std::endl;
+    if (receiveBuffer.empty())
+    {
+        log << "The board didn't respond !" << std::endl;
+        return false;
+    }
+    const std::string boardInformation = receiveBuffer;
+    EndPhase(stats, "info", phaseStart);
+
+    if ( (settings.targetBaudrate > port.getBaudrate() || settings.hardwareFlowControl) && !port.isLineConfigurable() )
+    {
+        //e.g. a serial port server, its line settings are configured on the server
+        if (settings.hardwareFlowControl)
+        {
+            log << "The flow control of the port \"" << port.getName() << "\" can't be changed !" << std::endl;
+            return false;
+        }
+        log << "The baudrate of the port \"" << port.getName() << "\" can't be changed, staying at " << port.getBaudrate() << " baud" << std::endl;
+    }
+    else if (settings.targetBaudrate > port.getBaudrate() || settings.hardwareFlowControl)
+    {
+        if (settings.hardwareFlowControl && !HasBoardHardwareFlowControl(boardInformation))
+        {
+            log << "The board doesn't support the RTS/CTS flow control !" << std::endl;
+            return false;
+        }
+        if ( !NegotiateBaudrate(port, boardInformation, settings.targetBaudrate, settings.hardwareFlowControl, log) )
+        {
+            log << "Can't negotiate the baudrate with the board !" << std::endl;
+            return false;
+        }
+    }
+
+    uint8_t boardEncodings = GetBoardEncodings(boardInformation);
+    if (settings.autoEncoding)
+    {
+        encoding = GetBestEncoding(boardEncodings);
+    }
+    else if ( !(boardEncodings & (1<<encoding)) )
+    {
+        log << "The board doesn't support the " << GetEncodingName(encoding) << " encoding !" << std::endl;
+        return false;
+    }
+
+    //The encoding is always set when the board knows the command, it may be kept from a previous transfer
+    if (boardEncodings != (1<<ENC_DECIMAL))
+    {
+        log << "Set data encoding to " << GetEncodingName(encoding) << " ... ";
+
+        BuildEncodingFrame(encoding, transmitBuffer);
+        sent = StatsClock::now();
+        port.write(transmitBuffer);
+        receiveBuffer = ReadReply(port, REPLY_TIMEOUT);
+        RecordCommand(stats, "E", transmitBuffer.size(), receiveBuffer.size(), sent);
+
+        log << receiveBuffer << std::endl;
+        if (receiveBuffer.size() != 2 || (receiveBuffer[0]-'0') != encoding)
+        {
+            log << "The board didn't respond or sent a bad response !" << std::endl;
+            return false;
+        }
+    }
+
+    uint8_t boardChecksums = GetBoardChecksums(boardInformation);
+    if (settings.autoChecksum)
+    {
+        checksumType = GetBestChecksum(boardChecksums);
+    }
+    else if ( !(boardChecksums & (1<<checksumType)) )
+    {
+        log << "The board doesn't support the " << GetChecksumName(checksumType) << " checksum !" << std::endl;
+        return false;
+    }
+
+    if (boardChecksums != (1<<CHECKSUM_SUM8))
+    {
+        log << "Set frame checksum to " << GetChecksumName(checksumType) << " ... ";
+
+        BuildChecksumFrame(checksumType, transmitBuffer);
+        sent = StatsClock::now();
+        port.write(transmitBuffer);
+        receiveBuffer = ReadReply(port, REPLY_TIMEOUT);
+        RecordCommand(stats, "S", transmitBuffer.size(), receiveBuffer.size(), sent);
+
+        log << receiveBuffer << std::endl;
+        if (receiveBuffer.size() != 2 || (receiveBuffer[0]-'0') != checksumType)
+        {
+            log << "The board didn't respond or sent a bad response !" << std::endl;
+            return false;
+        }
+    }
+
+    session.information = boardInformation;
+    session.encoding = encoding;
+    session.checksumType = checksumType;
+    EndPhase(stats, "negotiation", phaseStart);
+
+    return SelectMemoryModel(port, settings.memoryModel, session, log, stats);
+}
+bool SelectMemoryModel(Transport& port, uint8_t memoryModel, BoardSession& session, std::ostream& log, TransferStats* stats)
+{
+    std::string transmitBuffer;
+    std::string receiveBuffer;
+
+    StatsClock::time_point phaseStart = StatsClock::now();
+
+    log << "Set memory model ... ";
+
+    transmitBuffer = "$Mx#";
+    transmitBuffer[2] = memoryModel + '0';
+    const StatsClock::time_point sent = StatsClock::now();
+    port.write(transmitBuffer);
+    receiveBuffer = ReadReply(port, REPLY_TIMEOUT);
+    RecordCommand(stats, "M", transmitBuffer.size(), receiveBuffer.size(), sent);
+
+    log << receiveBuffer << std::endl;
+    if (receiveBuffer.size() == 2)
+    {
+        if ((receiveBuffer[0]-'0') != memoryModel)
+        {
+            log << "The board returned a bad memory model !" << std::endl;
+            return false;
+        }
+    }
+    else
+    {
+        log << "The board didn't respond or sent a bad response !" << std::endl;
+        return false;
+    }
+
+    EndPhase(stats, "model", phaseStart);
+
+    MemoryGeometry& geometry = session.geometry;
+    if ( !GetBoardGeometry(session.information, memoryModel, geometry) )
+    {
+        log << "The board sent a bad " << GetMemoryModelName(memoryModel) << " geometry !" << std::endl;
+        return false;
+    }
+    log << "Memory geometry : page " << geometry.pageSize << ", sector " << geometry.sectorSize
+        << ", up to " << geometry.maxPayload << " byte(s) per frame" << std::endl;
+
+    session.memoryModel = memoryModel;
+    return true;
+}
+
+int TransferFile(Transport& port, const std::vector<uint8_t>& fileData, const TransferSettings& settings, std::ostream& log, TransferStats* stats)
+{
+    BoardSession session;
+    if ( !OpenSession(port, settings, session, log, stats) )
+    {
+        return -1;
+    }
+    return TransferFile(port, fileData, settings, session, log, stats);
+}
+int TransferFile(Transport& port, const std::vector<uint8_t>& fileData, const TransferSettings& settings, const BoardSession& session, std::ostream& log, TransferStats* stats)
+{
+    std::string transmitBuffer;
+    std::string receiveBuffer;
+
+    const std::string& boardInformation = session.information;
+    const uint8_t encoding = session.encoding;
+    const uint8_t checksumType = session.checksumType;
+    const MemoryGeometry& geometry = session.geometry;
+
+    if (session.memoryModel != settings.memoryModel)
+    {
+        log << "The board is set to the " << GetMemoryModelName(session.memoryModel) << " memory model !" << std::endl;
+        return -1;
+    }
+
+    //The per chunk lines are dropped in quiet mode
+    std::ostream nullLog(nullptr);
+    std::ostream& chunkLog = settings.quiet ? nullLog : log;
+
+    StatsClock::time_point phaseStart = StatsClock::now();
+    StatsClock::time_point sent;
+
+    //The compression is chosen per frame, a plain frame can always be sent
+    const uint8_t boardCompressions = GetBoardCompressions(boardInformation);
+    uint8_t compressions = 1<<COMP_NONE;
+    if (settings.autoCompression)
+    {
+        compressions = boardCompressions;
+    }
+    else if ( !(boardCompressions & (1<<settings.compression)) )
+    {
+        log << "The board doesn't support the " << GetCompressionName(settings.compression) << " compression !" << std::endl;
+        return -1;
+    }
+    else
+    {
+        compressions |= 1<<settings.compression;
+    }
+
+    if (settings.enableWrite && compressions != (1<<COMP_NONE))
+    {
+        log << "Compressed write frames :";
+        for (uint8_t compression=COMP_NONE+1; compression<COMP_COUNT; ++compression)
+        {
+            if (compressions & (1<<compression))
+            {
+                log << " " << GetCompressionName(compression);
+            }
+        }
+        log << std::endl;
+    }
+
+    const bool boardRangeCrc = HasBoardCommand(boardInformation, "CRC");
+    if (settings.verifyMode == VERIFY_CRC && !boardRangeCrc)
+    {
+        log << "The board doesn't support the range CRC command !" << std::endl;
+        return -1;
+    }
+
+
+    ///Journal of the progress, to resume an interrupted transfer
+    TransferJournal journal;
+    std::string journalPath;
+    bool resuming = false;
+
+    if (settings.enableWrite)
+    {
+        journalPath = GetJournalPath(settings.manifestDirectory, port.getName());
+
+        journal.imageHash = CalculateHash(fileData.data(), fileData.size());
+        if ( !settings.segments.empty() )
+        {
+            journal.imageHash ^= CalculateHash(reinterpret_cast<const uint8_t*>(settings.segments.data()), settings.segments.size()*sizeof(AddressRange));
+        }
+        journal.startAddress = settings.startAddress;
+        journal.memoryModel = settings.memoryModel;
+        journal.boardIdentity = GetBoardIdentity(boardInformation);
+        journal.progressAddress = settings.startAddress;
+        journal.deltaMode = settings.deltaMode;
+
+        if (settings.resume)
+        {
+            TransferJournal previousJournal;
+            resuming = LoadJournal(journalPath, previousJournal) &&
+                       previousJournal.imageHash == journal.imageHash &&
+                       previousJournal.startAddress == journal.startAddress &&
+                       previousJournal.memoryModel == journal.memoryModel &&
+                       previousJournal.deltaMode == journal.deltaMode &&
+                       previousJournal.boardIdentity == journal.boardIdentity &&
+                       (previousJournal.writeRanges.empty() ||
+                        static_cast<uint64_t>(previousJournal.writeRanges.back().address) + previousJournal.writeRanges.back().size <= fileData.size());
+
+            if (resuming)
+            {
+                journal.progressAddress = previousJournal.progressAddress;
+                journal.erasedAddress = previousJournal.erasedAddress;
+                journal.writeRanges = previousJournal.writeRanges;
+                log << "Resuming from address " << journal.progressAddress << " with the journal \"" << journalPath << "\"" << std::endl;
+            }
+            else
+            {
+                log << "No matching journal \"" << journalPath << "\", the transfer starts over" << std::endl;
+            }
+        }
+    }
+
+    log << std::endl;
+
+    ///Populated ranges of the image from the start address, the holes between the segments are never written
+    AddressRangeList imageRanges;
+    if ( settings.segments.empty() )
+    {
+        PushRange(imageRanges, 0, static_cast<uint32_t>(fileData.size()));
+    }
+    else
+    {
+        if ( !CheckRanges(settings.segments, fileData.size()) )
+        {
+            log << "The segments must be sorted without overlap and within the file data !" << std::endl;
+            return -1;
+        }
+        imageRanges = settings.segments;
+    }
+    TrimRanges(imageRanges, settings.startAddress);
+
+    if (settings.segments.size() > 1)
+    {
+        log << GetRangesSize(imageRanges) << " byte(s) in " << imageRanges.size() << " segment(s)" << std::endl;
+    }
+
+    ///Planning the ranges to write
+    AddressRangeList writeRanges;
+    AddressRangeList blankRanges; //Skipped ranges that only contain the erased value
+    AddressRangeList eraseSectors; //in sectors
+    SectorHashMap sectorHashes;
+    SectorHashMap manifestHashes;
+    std::string manifestPath;
+
+    if (resuming)
+    {
+        //The same plan as the interrupted transfer, a delta compare would now see the ranges already written as identical
+        writeRanges = journal.writeRanges;
+
+        if (settings.deltaMode != DELTA_DISABLED)
+        {
+            manifestPath = GetManifestPath(settings.manifestDirectory, GetBoardIdentity(boardInformation), settings.memoryModel);
+            HashSectors(fileData.data(), imageRanges, geometry.sectorSize, sectorHashes);
+            LoadManifest(manifestPath, GetBoardIdentity(boardInformation), geometry.sectorSize, manifestHashes);
+        }
+    }
+    else if (settings.enableWrite && settings.deltaMode != DELTA_DISABLED)
+    {
+        const std::string boardIdentity = GetBoardIdentity(boardInformation);
+        manifestPath = GetManifestPath(settings.manifestDirectory, boardIdentity, settings.memoryModel);
+
+        HashSectors(fileData.data(), imageRanges, geometry.sectorSize, sectorHashes);
+
+        bool manifestLoaded = LoadManifest(manifestPath, boardIdentity, geometry.sectorSize, manifestHashes) && (settings.deltaMode == DELTA_AUTO);
+
+        if (manifestLoaded)
+        {
+            log << "Comparing with the manifest \"" << manifestPath << "\" ..." << std::endl;
+        }
+        else
+        {
+            log << "Comparing with the board memory" << (boardRangeCrc ? " (CRC)" : "") << " ..." << std::endl;
+        }
+
+        for (const auto& sector : sectorHashes)
+        {
+            //Only the populated parts of the sector are compared and written
+            AddressRangeList sectorRanges;
+            IntersectRanges(imageRanges, sector.second.address, sector.second.size, sectorRanges);
+
+            bool identical = true;
+
+            if (manifestLoaded)
+            {
+                auto it = manifestHashes.find(sector.first);
+                identical = (it != manifestHashes.end()) &&
+                            it->second.address == sector.second.address &&
+                            it->second.size == sector.second.size &&
+                            it->second.hash == sector.second.hash;
+            }
+            else
+            {
+                for (std::size_t i=0; i<sectorRanges.size() && identical; ++i)
+                {
+                    const AddressRange& range = sectorRanges[i];
+
+                    if (boardRangeCrc)
+                    {
+                        if ( !CompareRangeCrc(port, fileData.data()+range.address, range.address, range.size, identical, log, stats) )
+                        {
+                            return -1;
+                        }
+                    }
+                    else if ( !CompareRange(port, fileData.data()+range.address, range.address, range.size,
+                                            settings.verifyBlockSize, encoding, checksumType, identical, log, stats) )
+                    {
+                        return -1;
+                    }
+                }
+            }
+
+            if (identical)
+            {
+                continue;
+            }
+
+            log << "Sector " << sector.first << " changed" << std::endl;
+
+            for (const AddressRange& range : sectorRanges)
+            {
+                PushRange(writeRanges, range.address, range.size);
+            }
+        }
+
+        log << writeRanges.size() << " changed range(s) in " << sectorHashes.size() << " sector(s)" << std::endl;
+
+        //The manifest is not valid anymore until the end of the transfer
+        if (!writeRanges.empty())
+        {
+            std::remove(manifestPath.c_str());
+        }
+    }
+    else
+    {
+        writeRanges = imageRanges;
+    }
+
+    //The holes of an erased flash already have the filler value, writing a small one saves a frame
+    if (!resuming && settings.enableWrite && settings.memoryModel == MEMM_FLASH && settings.enableFlashErase && writeRanges.size() > 1)
+    {
+        const std::size_t rangeCount = writeRanges.size();
+        CoalesceRanges(fileData.data(), writeRanges, std::min(geometry.maxPayload, geometry.sectorSize-1), geometry.erasedValue);
+
+        if (writeRanges.size() < rangeCount)
+        {
+            log << (rangeCount - writeRanges.size()) << " small hole(s) written with the erased value" << std::endl;
+        }
+    }
+
+    if (!resuming)
+    {
+        journal.writeRanges = writeRanges;
+    }
+
+    //Only the sectors touched by the written data are erased
+    GetSectorRanges(writeRanges, geometry.sectorSize, eraseSectors);
+
+    if (settings.sparseMode)
+    {
+        AddressRangeList dataRanges;
+        SplitBlankRanges(fileData.data(), writeRanges, geometry.pageSize ? geometry.pageSize : geometry.maxPayload, geometry.erasedValue, dataRanges, blankRanges);
+        writeRanges.swap(dataRanges);
+
+        log << "Sparse mode : " << GetRangesSize(blankRanges) << " blank byte(s) skipped in "
+                  << blankRanges.size() << " range(s)" << std::endl;
+    }
+
+    //The ranges written before the interruption are not written again, but still verified
+    const AddressRangeList verifyRanges = writeRanges;
+    if (resuming)
+    {
+        TrimRanges(writeRanges, journal.progressAddress);
+    }
+
+    //An interrupted transfer only erases the sectors it didn't erase yet
+    if (resuming)
+    {
+        TrimRanges(eraseSectors, static_cast<uint32_t>((static_cast<uint64_t>(journal.erasedAddress) + geometry.sectorSize-1) / geometry.sectorSize));
+    }
+
+    const uint64_t transferSize = GetRangesSize(writeRanges);
+    EndPhase(stats, "planning", phaseStart);
+
+    //Sectors erased one by one just ahead of the write cursor, their erase time is hidden behind the frames on the wire
+    bool overlappedErase = false;
+
+    if (settings.enableWrite)
+    {
+        if (settings.memoryModel == MEMM_FLASH)
+        {
+            for (const AddressRange& sectors : eraseSectors)
+            {
+                if (settings.enableFlashErase && static_cast<uint64_t>(sectors.address) + sectors.size > MAX_FLASH_SECTOR+1)
+                {
+                    log << "Sectors " << sectors.address << " to " << (sectors.address+sectors.size-1) << " can't be erased by the board !" << std::endl;
+                    return -1;
+                }
+            }
+
+            if (!settings.enableFlashErase)
+            {
+                log << "Flash erase skipped" << std::endl;
+            }
+            else if (resuming && eraseSectors.empty())
+            {
+                log << "Flash erase skipped (resuming)" << std::endl;
+            }
+            else if (settings.eraseAhead > 0)
+            {
+                log << "Erasing sector by sector, up to " << settings.eraseAhead << " sector(s) ahead of the write cursor" << std::endl;
+                overlappedErase = true;
+                if (!resuming)
+                {
+                    journal.erasedAddress = 0;
+                }
+            }
+            else
+            {
+                for (const AddressRange& sectors : eraseSectors)
+                {
+                    //The sector count of a frame is also limited to MAX_FLASH_SECTOR
+                    for (uint32_t offset=0; offset<sectors.size; offset+=MAX_FLASH_SECTOR)
+                    {
+                        const uint8_t startSector = static_cast<uint8_t>(sectors.address + offset);
+                        const uint8_t countSector = static_cast<uint8_t>(std::min<uint32_t>(sectors.size - offset, MAX_FLASH_SECTOR));
+
+                        log << "Erasing from sector "<< static_cast<int>(startSector) <<" to sector " << (startSector+countSector-1) << " ..."  << std::endl;
+                        BuildFlashEraseFrame(startSector, countSector, transmitBuffer);
+
+                        sent = StatsClock::now();
+                        port.write(transmitBuffer);
+                        receiveBuffer = ReadReply(port, REPLY_TIMEOUT + GetEraseTimeout(geometry, countSector));
+                        RecordCommand(stats, "FES", transmitBuffer.size(), receiveBuffer.size(), sent);
+                        log << receiveBuffer << std::endl;
+                        if (receiveBuffer.find("ERASED") == std::string::npos)
+                        {
+                            log << "The board didn't respond or sent a bad response !" << std::endl;
+                            return -1;
+                        }
+                    }
+                }
+                journal.erasedAddress = JOURNAL_ALL_ERASED;
+            }
+        }
+
+        EndPhase(stats, "erase", phaseStart);
+
+        log << "Write and verify a total of " << transferSize << " byte(s) ..." << std::endl << std::endl;
+    }
+    else
+    {
+        log << "Write skipped" << std::endl;
+        log << "Verify only a total of " << transferSize << " byte(s) ..." << std::endl << std::endl;
+    }
+
+    std::deque<EncodedChunk> pendingChunks;
+
+    const bool immediateVerify = (settings.verifyMode == VERIFY_IMMEDIATE);
+
+    uint32_t transferredSize = 0;
+
+    if (settings.windowSize > 1)
+    {
+        log << "Pipelined transfer with a window of " << settings.windowSize << " frame(s)" << std::endl << std::endl;
+    }
+
+    //The next frames are built on another thread while the current ones are on the wire
+    ChunkEncoder encoder(fileData.data(), writeRanges, geometry, encoding, checksumType, compressions,
+                         settings.enableWrite, settings.windowSize > 1, immediateVerify,
+                         settings.windowSize + DEFAULT_READAHEAD);
+    bool encoderFinished = !(settings.enableWrite || immediateVerify);
+
+    ///Overlapped erase, the erase commands are sent between the frames and their replies come in the same order
+    struct PendingErase
+    {
+        uint8_t sector;
+        uint64_t beforeChunk; //Index of the chunk sent after the erase
+        StatsClock::time_point sent;
+    };
+    std::deque<PendingErase> pendingErases;
+    std::vector<uint8_t> eraseQueue;
+    std::size_t nextErase = 0;
+    uint64_t sentChunks = 0;
+    uint64_t acknowledgedChunks = 0;
+
+    if (overlappedErase)
+    {
+        for (const AddressRange& sectors : eraseSectors)
+        {
+            for (uint32_t sector=sectors.address; sector<sectors.address+sectors.size; ++sector)
+            {
+                eraseQueue.push_back(static_cast<uint8_t>(sector));
+            }
+        }
+    }
+
+    auto sendErase = [&](PendingErase& erase)
+    {
+        chunkLog << "Erasing sector " << static_cast<int>(erase.sector) << " ..." << std::endl;
+
+        BuildFlashEraseFrame(erase.sector, 1, transmitBuffer);
+        erase.sent = StatsClock::now();
+        port.write(transmitBuffer);
+    };
+    //Erase every sector up to the last one, in order
+    auto sendErases = [&](uint32_t lastSector)
+    {
+        while ( nextErase < eraseQueue.size() && eraseQueue[nextErase] <= lastSector )
+        {
+            PendingErase erase{eraseQueue[nextErase++], sentChunks, StatsClock::time_point()};
+            sendErase(erase);
+            pendingErases.push_back(erase);
+        }
+    };
+    //Check the replies of the erases sent before the oldest chunk
+    auto acknowledgeErases = [&]() -> bool
+    {
+        while ( !pendingErases.empty() && pendingErases.front().beforeChunk <= acknowledgedChunks )
+        {
+            const PendingErase& erase = pendingErases.front();
+
+            std::string eraseReply = ReadReply(port, REPLY_TIMEOUT + GetEraseTimeout(geometry, 1));
+            if (eraseReply.find("ERASED") == std::string::npos)
+            {
+                log << "The board didn't respond or sent a bad response to the erase of sector " << static_cast<int>(erase.sector) << " !" << std::endl;
+                return false;
+            }
+            RecordCommand(stats, "FES", FRAME_FLASHERASE_SIZE, eraseReply.size(), erase.sent);
+            chunkLog << "Sector " << static_cast<int>(erase.sector) << " ERASED" << std::endl;
+
+            journal.erasedAddress = (erase.sector+1) * geometry.sectorSize;
+            pendingErases.pop_front();
+        }
+        return true;
+    };
+
+    //Send the frames of a chunk, with a single frame window the write is acknowledged before the read
+    auto sendChunk = [&](EncodedChunk& chunk) -> bool
+    {
+        if (settings.enableWrite)
+        {
+            chunkLog << "Writing " << static_cast<unsigned int>(chunk.numOfData) << " byte(s) of data at address " << chunk.address;
+            if (chunk.compression != COMP_NONE)
+            {
+                chunkLog << " (" << GetCompressionName(chunk.compression) << ", " << chunk.writeFrame.size() << " character(s))";
+            }
+            chunkLog << " ... ";
+
+            chunk.writeSent = StatsClock::now();
+            port.write(chunk.writeFrame);
+
+            if (settings.windowSize == 1)
+            {
+                if ( !acknowledgeErases() )
+                {
+                    return false;
+                }
+                receiveBuffer = ReadReply(port, REPLY_TIMEOUT + GetWireTime(port, chunk.writeFrame.size()) +
+                                                GetWriteTimeout(geometry, chunk.address, chunk.numOfData));
+
+                chunkLog << receiveBuffer << std::endl;
+                if (receiveBuffer != "WRITED\n")
+                {
+                    log << "The board didn't respond or sent a bad response at address " << chunk.address << " !" << std::endl;
+                    return false;
+                }
+                RecordCommand(stats, chunk.writeFrame.substr(1, 1), chunk.writeFrame.size(), receiveBuffer.size(), chunk.writeSent);
+            }
+            else
+            {
+                chunkLog << "(frame " << static_cast<unsigned int>(chunk.sequence) << ")" << std::endl;
+            }
+        }
+
+        if (immediateVerify)
+        {
+            chunkLog << "Reading " << static_cast<unsigned int>(chunk.numOfData) << " byte(s) at address " << chunk.address << " ... " << std::endl;
+
+            chunk.readSent = StatsClock::now();
+            port.write(chunk.readFrame);
+        }
+        return true;
+    };
+
+    //Check the replies of the oldest chunk (the board answers in order)
+    auto acknowledgeChunk = [&](const EncodedChunk& chunk) -> bool
+    {
+        if ( !acknowledgeErases() )
+        {
+            return false;
+        }
+
+        //Every chunk and erase in flight can be before the reply on the wire and in the board
+        const std::size_t readSize = immediateVerify ? chunk.readFrame.size() + chunk.readReplySize : 0;
+        SetReplyTimeout(port, REPLY_TIMEOUT + static_cast<uint32_t>(pendingChunks.size()) *
+                        (GetWireTime(port, chunk.writeFrame.size() + FRAME_WRITEDSEQ_SIZE + readSize) +
+                         (settings.enableWrite ? GetWriteTimeout(geometry, chunk.address, chunk.numOfData) : 0)) +
+                        static_cast<uint32_t>(pendingErases.size()) * GetEraseTimeout(geometry, 1));
+
+        if (settings.enableWrite && settings.windowSize > 1)
+        {
+            receiveBuffer = port.read(FRAME_WRITEDSEQ_SIZE);
+
+            uint8_t sequence;
+            if ( !GetWritedSequence(receiveBuffer, sequence) )
+            {
+                log << "The board didn't respond or sent a bad response for frame " << static_cast<unsigned int>(chunk.sequence) << " !" << std::endl;
+                return false;
+            }
+            if (sequence != chunk.sequence)
+            {
+                bool outstanding = false;
+                for (const EncodedChunk& pendingChunk : pendingChunks)
+                {
+                    outstanding |= (pendingChunk.sequence == sequence);
+                }
+                if (outstanding)
+                {
+                    log << "The board skipped frame " << static_cast<unsigned int>(chunk.sequence)
+                              << " (acknowledged frame " << static_cast<unsigned int>(sequence) << ") !" << std::endl;
+                }
+                else
+                {
+                    log << "The board acknowledged an unknown frame " << static_cast<unsigned int>(sequence) << " !" << std::endl;
+                }
+                return false;
+            }
+            chunkLog << "Frame " << static_cast<unsigned int>(sequence) << " WRITED at address " << chunk.address << std::endl;
+            RecordCommand(stats, chunk.writeFrame.substr(1, 1), chunk.writeFrame.size(), receiveBuffer.size(), chunk.writeSent);
+        }
+
+        if (immediateVerify)
+        {
+            receiveBuffer = port.read(chunk.readReplySize);
+
+            chunkLog << receiveBuffer << std::endl;
+            if ( receiveBuffer.size() != chunk.readReplySize )
+            {
+                log << "The board didn't respond or sent a bad response at address " << chunk.address << " !" << std::endl;
+                return false;
+            }
+            RecordCommand(stats, "R", chunk.readFrame.size(), receiveBuffer.size(), chunk.readSent);
+
+            ///Compare
+            if ( !CheckReadReply(receiveBuffer, chunk.address, chunk.data, chunk.numOfData, encoding, checksumType) )
+            {
+                log << "The board didn't do a successfully write/read to the memory !" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    };
+
+    unsigned int retries = 0; //of the oldest chunk
+    unsigned int lastPercent = 100;
+    uint32_t journalAddress = journal.progressAddress;
+
+    while ( !encoderFinished || !pendingChunks.empty() )
+    {
+        bool success = true;
+
+        ///Filling the window
+        while ( success && !encoderFinished && pendingChunks.size() < settings.windowSize )
+        {
+            EncodedChunk chunk;
+            if ( !encoder.pop(chunk) )
+            {
+                encoderFinished = true;
+                break;
+            }
+
+            //Every 10% in quiet mode
+            const unsigned int percent = (static_cast<uint64_t>(transferredSize)*100)/transferSize;
+            if (!settings.quiet || percent/10 != lastPercent/10)
+            {
+                log << percent << "% done ..." << std::endl;
+                lastPercent = percent;
+            }
+            transferredSize += chunk.numOfData;
+
+            if (overlappedErase)
+            {
+                sendErases((chunk.address + chunk.numOfData-1) / geometry.sectorSize + settings.eraseAhead);
+            }
+
+            pendingChunks.push_back(std::move(chunk));
+            ++sentChunks;
+            success = sendChunk(pendingChunks.back());
+        }
+
+        if ( success && pendingChunks.empty() )
+        {
+            break;
+        }
+
+        success = success && acknowledgeChunk(pendingChunks.front());
+        if (success)
+        {
+            EncodedChunk& chunk = pendingChunks.front();
+
+            retries = 0;
+            journal.progressAddress = chunk.address + chunk.numOfData;
+            if (!journalPath.empty() && journal.progressAddress - journalAddress >= geometry.sectorSize)
+            {
+                SaveJournal(journalPath, journal);
+                journalAddress = journal.progressAddress;
+            }
+
+            encoder.recycle(std::move(chunk));
+            pendingChunks.pop_front();
+            ++acknowledgedChunks;
+            continue;
+        }
+
+        ///Retrying every chunk in flight, from the failed one
+        while (!success)
+        {
+            if (retries >= settings.retryCount)
+            {
+                if ( !journalPath.empty() && SaveJournal(journalPath, journal) )
+                {
+                    log << "The progress is saved, the transfer can be resumed with --resume" << std::endl;
+                }
+                return -1;
+            }
+            ++retries;
+            if (stats != nullptr)
+            {
+                ++stats->retries;
+            }
+
+            log << "Retrying from address " << pendingChunks.front().address << " (" << retries << "/" << settings.retryCount << ") ..." << std::endl;
+
+            success = Resync(port);
+            for (std::size_t i=0; success && i<pendingErases.size(); ++i)
+            {
+                //None of the chunks of the sector is acknowledged yet, erasing it again is harmless
+                pendingErases[i].beforeChunk = acknowledgedChunks;
+                sendErase(pendingErases[i]);
+            }
+            for (std::size_t i=0; success && i<pendingChunks.size(); ++i)
+            {
+                success = sendChunk(pendingChunks[i]);
+            }
+        }
+    }
+
+    ///The sectors without data to write (sparse mode) are erased last
+    if (overlappedErase)
+    {
+        sendErases(0xFF);
+
+        unsigned int eraseRetries = 0;
+        while ( !acknowledgeErases() )
+        {
+            do
+            {
+                if (eraseRetries >= settings.retryCount)
+                {
+                    return -1;
+                }
+                ++eraseRetries;
+                if (stats != nullptr)
+                {
+                    ++stats->retries;
+                }
+
+                log << "Retrying the erase (" << eraseRetries << "/" << settings.retryCount << ") ..." << std::endl;
+            }
+            while ( !Resync(port) );
+
+            for (PendingErase& erase : pendingErases)
+            {
+                sendErase(erase);
+            }
+        }
+    }
+
+    if (stats != nullptr)
+    {
+        stats->payloadBytes = (settings.enableWrite || immediateVerify) ? transferredSize : GetRangesSize(verifyRanges);
+    }
+    if (settings.enableWrite || immediateVerify)
+    {
+        EndPhase(stats, settings.enableWrite ? "write" : "verify", phaseStart);
+    }
+
+    //A failed range check is done again after a resync, a real mismatch fails every time
+    auto retryRange = [&](const std::function<bool()>& check) -> bool
+    {
+        unsigned int rangeRetries = 0;
+        while ( !check() )
+        {
+            do
+            {
+                if (rangeRetries >= settings.retryCount)
+                {
+                    return false;
+                }
+                ++rangeRetries;
+                if (stats != nullptr)
+                {
+                    ++stats->retries;
+                }
+
+                log << "Retrying (" << rangeRetries << "/" << settings.retryCount << ") ..." << std::endl;
+            }
+            while ( !Resync(port) );
+        }
+        return true;
+    };
+
+    if (!immediateVerify)
+    {
+        if (settings.verifyMode == VERIFY_CRC)
+        {
+            log << "Verifying a total of " << GetRangesSize(verifyRanges) << " byte(s) with the board CRC ..." << std::endl;
+        }
+        else
+        {
+            log << "Verifying a total of " << GetRangesSize(verifyRanges) << " byte(s) in blocks of " << settings.verifyBlockSize << " byte(s) ..." << std::endl;
+        }
+
+        for (const AddressRange& range : verifyRanges)
+        {
+            bool success = retryRange([&](){
+                return (settings.verifyMode == VERIFY_CRC) ?
+                    VerifyRangeCrc(port, fileData.data()+range.address, range.address, range.size, settings.verifyBlockSize, encoding, checksumType, log, stats) :
+                    VerifyRange(port, fileData.data()+range.address, range.address, range.size, settings.verifyBlockSize, encoding, checksumType, log, stats);
+            });
+            if (!success)
+            {
+                log << "The board didn't do a successfully write/read to the memory !" << std::endl;
+                return -1;
+            }
+        }
+        EndPhase(stats, "verify", phaseStart);
+    }
+
+    if ( !blankRanges.empty() )
+    {
+        const bool boardBlankCheck = HasBoardCommand(boardInformation, "BLANK");
+
+        log << "Checking a total of " << GetRangesSize(blankRanges) << " blank byte(s)"
+                  << (boardBlankCheck ? "" : " with a read back") << " ..." << std::endl;
+
+        for (const AddressRange& range : blankRanges)
+        {
+            bool success = retryRange([&](){
+                if (boardBlankCheck)
+                {
+                    return BlankCheckRange(port, range.address, range.size, log, stats);
+                }
+                if (boardRangeCrc)
+                {
+                    return VerifyRangeCrc(port, fileData.data()+range.address, range.address, range.size, settings.verifyBlockSize, encoding, checksumType, log, stats);
+                }
+                return VerifyRange(port, fileData.data()+range.address, range.address, range.size, settings.verifyBlockSize, encoding, checksumType, log, stats);
+            });
+            if (!success)
+            {
+                log << "The board memory is not blank where it should be !" << std::endl;
+                return -1;
+            }
+        }
+        EndPhase(stats, "blank check", phaseStart);
+    }
+
+    if ( !manifestPath.empty() )
+    {
+        for (const auto& sector : sectorHashes)
+        {
+            manifestHashes[sector.first] = sector.second;
+        }
+
+        if ( !SaveManifest(manifestPath, GetBoardIdentity(boardInformation), geometry.sectorSize, manifestHashes) )
+        {
+            log << "Can't save the manifest \"" << manifestPath << "\" !" << std::endl;
+        }
+    }
+
+    if ( !journalPath.empty() )
+    {
+        std::remove(journalPath.c_str());
+    }
+
+    log << "The board successfully write/read to the memory !" << std::endl;
+
+    return 0;
+}
+
+int DumpMemory(Transport& port, uint32_t address, uint32_t size, std::vector<uint8_t>& data, const TransferSettings& settings, const BoardSession& session, std::ostream& log, TransferStats* stats)
+{
+    if (session.memoryModel != settings.memoryModel)
+    {
+        log << "The board is set to the " << GetMemoryModelName(session.memoryModel) << " memory model !" << std::endl;
+        return -1;
+    }
+
+    StatsClock::time_point phaseStart = StatsClock::now();
+
+    log << "Dumping " << size << " byte(s) from address " << address << " in blocks of " << std::min(settings.dumpBlockSize, size) << " byte(s)";
+    if (settings.windowSize > 1)
+    {
+        log << ", up to " << settings.windowSize << " request(s) in flight";
+    }
+    log << " ..." << std::endl << std::endl;
+
+    data.resize(size);
+    if ( !DumpRange(port, data.data(), address, size, settings, session, log, stats) )
+    {
+        log << "Can't dump the board memory !" << std::endl;
+        return -1;
+    }
+
+    if (stats != nullptr)
+    {
+        stats->payloadBytes = size;
+    }
+    EndPhase(stats, "dump", phaseStart);
+
+    log << "The board memory is dumped !" << std::endl;
+    return 0;
+}
@@ -0,0 +1,509 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+#include "C_transport.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include "C_transfer.hpp"
+
+#ifndef _WIN32
+    #include <sys/types.h>
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <netdb.h>
+    #include <poll.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <cerrno>
+
+    #ifndef MSG_NOSIGNAL
+        #define MSG_NOSIGNAL 0
+    #endif
+#endif //_WIN32
+
+namespace
+{
+
+//Take up to size bytes of a receive buffer, the consumed part is dropped once it is the largest
+std::string TakeReceived(std::string& buffer, std::size_t& pos, std::size_t size)
+{
+    std::string data = buffer.substr(pos, size);
+    pos += data.size();
+    if (pos >= buffer.size()/2)
+    {
+        buffer.erase(0, pos);
+        pos = 0;
+    }
+    return data;
+}
+//Size of the line at the start of the receive buffer, 0 if it is not complete
+std::size_t GetReceivedLineSize(const std::string& buffer, std::size_t pos, std::size_t maxSize)
+{
+    const std::size_t end = buffer.find('\n', pos);
+    if (end != std::string::npos && end-pos < maxSize)
+    {
+        return end-pos+1;
+    }
+    return buffer.size()-pos >= maxSize ? maxSize : 0;
+}
+
+} // namespace
+
+///SerialTransport
+
+SerialTransport::SerialTransport(const std::string& portName, uint32_t baudrate, uint32_t timeout) :
+    _g_port(portName, baudrate, serial::Timeout::simpleTimeout(timeout),
+            serial::bytesize_t::eightbits,
+            serial::parity_t::parity_none,
+            serial::stopbits_t::stopbits_one,
+            serial::flowcontrol_t::flowcontrol_none),
+    _g_timeout(timeout)
+{
+}
+
+std::string SerialTransport::getName() const
+{
+    return this->_g_port.getPort();
+}
+
+std::size_t SerialTransport::write(const std::string& data)
+{
+    return this->_g_port.write(data);
+}
+std::string SerialTransport::read(std::size_t size)
+{
+    return this->_g_port.read(size);
+}
+std::string SerialTransport::readLine(std::size_t maxSize)
+{
+    return this->_g_port.readline(maxSize, "\n");
+}
+
+void SerialTransport::flush()
+{
+    this->_g_port.flush();
+}
+void SerialTransport::flushInput()
+{
+    this->_g_port.flushInput();
+}
+
+void SerialTransport::setReadTimeout(uint32_t timeout)
+{
+    if (this->_g_timeout != timeout)
+    {
+        serial::Timeout portTimeout = serial::Timeout::simpleTimeout(timeout);
+        this->_g_port.setTimeout(portTimeout);
+        this->_g_timeout = timeout;
+    }
+}
+
+bool SerialTransport::isLineConfigurable() const
+{
+    return true;
+}
+bool SerialTransport::isWireLimited() const
+{
+    return true;
+}
+uint32_t SerialTransport::getBaudrate() const
+{
+    return this->_g_port.getBaudrate();
+}
+void SerialTransport::setBaudrate(uint32_t baudrate)
+{
+    this->_g_port.setBaudrate(baudrate);
+}
+void SerialTransport::setHardwareFlowControl(bool enabled)
+{
+    this->_g_port.setFlowcontrol(enabled ? serial::flowcontrol_hardware : serial::flowcontrol_none);
+}
+
+bool SerialTransport::isOpen() const
+{
+    return this->_g_port.isOpen();
+}
+
+#ifndef _WIN32
+
+///TcpTransport
+
+TcpTransport::TcpTransport(const std::string& host, const std::string& service, uint32_t baudrate, uint32_t timeout) :
+    _g_host(host),
+    _g_service(service),
+    _g_fd(-1),
+    _g_bufferPos(0),
+    _g_baudrate(baudrate),
+    _g_timeout(timeout)
+{
+}
+TcpTransport::~TcpTransport()
+{
+    if (this->_g_fd >= 0)
+    {
+        close(this->_g_fd);
+    }
+}
+
+bool TcpTransport::connect(std::string& error)
+{
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* addresses = nullptr;
+    const int result = getaddrinfo(this->_g_host.c_str(), this->_g_service.c_str(), &hints, &addresses);
+    if (result != 0)
+    {
+        error = gai_strerror(result);
+        return false;
+    }
+
+    for (addrinfo* address = addresses; address != nullptr && this->_g_fd < 0; address = address->ai_next)
+    {
+        const int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (fd < 0)
+        {
+            error = std::strerror(errno);
+            continue;
+        }
+
+        //Non-blocking, so the connection and the writes can time out
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+        int connectError = 0;
+        if ( ::connect(fd, address->ai_addr, address->ai_addrlen) != 0 )
+        {
+            connectError = errno;
+            if (connectError == EINPROGRESS)
+            {
+                pollfd pollFd{fd, POLLOUT, 0};
+                connectError = ETIMEDOUT;
+                if (poll(&pollFd, 1, TCP_CONNECT_TIMEOUT) > 0)
+                {
+                    socklen_t size = sizeof(connectError);
+                    getsockopt(fd, SOL_SOCKET, SO_ERROR, &connectError, &size);
+                }
+            }
+        }
+        if (connectError != 0)
+        {
+            error = std::strerror(connectError);
+            close(fd);
+            continue;
+        }
+
+        //Every write is a complete frame, waiting for the ack of the previous one would only add latency
+        int enabled = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+
+        this->_g_fd = fd;
+    }
+
+    freeaddrinfo(addresses);
+    return this->_g_fd >= 0;
+}
+
+std::string TcpTransport::getName() const
+{
+    return TRANSPORT_TCP_PREFIX + this->_g_host + ":" + this->_g_service;
+}
+
+std::size_t TcpTransport::write(const std::string& data)
+{
+    std::size_t written = 0;
+    while (written < data.size())
+    {
+        const ssize_t size = send(this->_g_fd, data.data()+written, data.size()-written, MSG_NOSIGNAL);
+        if (size > 0)
+        {
+            written += size;
+            continue;
+        }
+        if (size < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if ( size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) )
+        {
+            pollfd pollFd{this->_g_fd, POLLOUT, 0};
+            if (poll(&pollFd, 1, this->_g_timeout) > 0)
+            {
+                continue;
+            }
+        }
+        throw std::runtime_error("Can't write to \"" + this->getName() + "\"");
+    }
+    return written;
+}
+std::string TcpTransport::read(std::size_t size)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(this->_g_timeout);
+
+    while (this->_g_buffer.size()-this->_g_bufferPos < size)
+    {
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if ( remaining <= 0 || !this->receive(static_cast<int>(remaining)) )
+        {
+            break;
+        }
+    }
+    return TakeReceived(this->_g_buffer, this->_g_bufferPos, size);
+}
+std::string TcpTransport::readLine(std::size_t maxSize)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(this->_g_timeout);
+
+    std::size_t size;
+    while ( (size = GetReceivedLineSize(this->_g_buffer, this->_g_bufferPos, maxSize)) == 0 )
+    {
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if ( remaining <= 0 || !this->receive(static_cast<int>(remaining)) )
+        {
+            //Partial line on timeout, like a serial port
+            size = this->_g_buffer.size()-this->_g_bufferPos;
+            break;
+        }
+    }
+    return TakeReceived(this->_g_buffer, this->_g_bufferPos, size);
+}
+
+void TcpTransport::flush()
+{
+    //The data is in the socket once written, the Nagle algorithm doesn't hold it
+}
+void TcpTransport::flushInput()
+{
+    while ( this->receive(0) )
+    {
+    }
+    this->_g_buffer.clear();
+    this->_g_bufferPos = 0;
+}
+
+void TcpTransport::setReadTimeout(uint32_t timeout)
+{
+    this->_g_timeout = timeout;
+}
+
+bool TcpTransport::isLineConfigurable() const
+{
+    return false;
+}
+bool TcpTransport::isWireLimited() const
+{
+    //The serial line is on the server side, at its baudrate
+    return true;
+}
+uint32_t TcpTransport::getBaudrate() const
+{
+    return this->_g_baudrate;
+}
+void TcpTransport::setBaudrate(uint32_t)
+{
+    //The line settings are the ones of the server
+}
+void TcpTransport::setHardwareFlowControl(bool)
+{
+}
+
+bool TcpTransport::receive(int timeout)
+{
+    pollfd pollFd{this->_g_fd, POLLIN, 0};
+    const int result = poll(&pollFd, 1, timeout);
+    if (result == 0)
+    {
+        return false;
+    }
+    if (result < 0)
+    {
+        return errno == EINTR;
+    }
+
+    char block[TCP_RECEIVE_BLOCK];
+    const ssize_t size = recv(this->_g_fd, block, sizeof(block), 0);
+    if (size > 0)
+    {
+        this->_g_buffer.append(block, size);
+        return true;
+    }
+    if ( size < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) )
+    {
+        return true;
+    }
+    throw std::runtime_error("The connection to \"" + this->getName() + "\" is closed");
+}
+
+#endif //_WIN32
+
+///LoopbackTransport
+
+LoopbackTransport::LoopbackTransport(const EmulatorSettings& settings) :
+    _g_emulator(settings),
+    _g_inFrame(false),
+    _g_bufferPos(0),
+    _g_baudrate(DEFAULT_BAUDRATE)
+{
+}
+
+std::string LoopbackTransport::getName() const
+{
+    return TRANSPORT_LOOPBACK_NAME;
+}
+
+std::size_t LoopbackTransport::write(const std::string& data)
+{
+    std::lock_guard<std::mutex> lock(this->_g_mutex);
+
+    //Every complete command is executed right away, its reply is ready to be read
+    for (char c : data)
+    {
+        if (!this->_g_inFrame)
+        {
+            if (c == '$')
+            {
+                this->_g_inFrame = true;
+                this->_g_frame = c;
+            }
+            continue;
+        }
+
+        this->_g_frame += c;
+        if (c == '#')
+        {
+            this->_g_inFrame = false;
+
+            uint32_t processingTime;
+            this->_g_buffer += this->_g_emulator.execute(this->_g_frame, processingTime);
+        }
+    }
+    return data.size();
+}
+std::string LoopbackTransport::read(std::size_t size)
+{
+    std::lock_guard<std::mutex> lock(this->_g_mutex);
+    return TakeReceived(this->_g_buffer, this->_g_bufferPos, size);
+}
+std::string LoopbackTransport::readLine(std::size_t maxSize)
+{
+    std::lock_guard<std::mutex> lock(this->_g_mutex);
+
+    std::size_t size = GetReceivedLineSize(this->_g_buffer, this->_g_bufferPos, maxSize);
+    if (size == 0)
+    {
+        size = this->_g_buffer.size()-this->_g_bufferPos;
+    }
+    return TakeReceived(this->_g_buffer, this->_g_bufferPos, size);
+}
+
+void LoopbackTransport::flush()
+{
+}
+void LoopbackTransport::flushInput()
+{
+    std::lock_guard<std::mutex> lock(this->_g_mutex);
+    this->_g_buffer.clear();
+    this->_g_bufferPos = 0;
+}
+
+void LoopbackTransport::setReadTimeout(uint32_t)
+{
+    //The replies are received as soon as the commands are written, there is nothing to wait for
+}
+
+bool LoopbackTransport::isLineConfigurable() const
+{
+    return true;
+}
+bool LoopbackTransport::isWireLimited() const
+{
+    //The baudrate is only kept for the negotiation, the frames are executed as soon as they are written
+    return false;
+}
+uint32_t LoopbackTransport::getBaudrate() const
+{
+    return this->_g_baudrate;
+}
+void LoopbackTransport::setBaudrate(uint32_t baudrate)
+{
+    this->_g_baudrate = baudrate;
+}
+void LoopbackTransport::setHardwareFlowControl(bool)
+{
+}
+
+const Emulator& LoopbackTransport::getEmulator() const
+{
+    return this->_g_emulator;
+}
+
+///Factory
+
+std::unique_ptr<Transport> OpenTransport(const std::string& portName, std::ostream& log)
+{
+    const std::size_t tcpPrefixSize = std::strlen(TRANSPORT_TCP_PREFIX);
+
+    if (portName.compare(0, tcpPrefixSize, TRANSPORT_TCP_PREFIX) == 0)
+    {
+#ifdef _WIN32
+        log << "The TCP ports are not available on Windows !" << std::endl;
+        return nullptr;
+#else
+        const std::string address = portName.substr(tcpPrefixSize);
+        const std::size_t separator = address.rfind(':');
+        if (separator == std::string::npos || separator == 0 || separator+1 == address.size())
+        {
+            log << "Bad TCP port \"" << portName << "\", must be " TRANSPORT_TCP_PREFIX "<host>:<port> !" << std::endl;
+            return nullptr;
+        }
+
+        //An IPv6 address is given between brackets
+        std::string host = address.substr(0, separator);
+        if (host.size() > 2 && host.front() == '[' && host.back() == ']')
+        {
+            host = host.substr(1, host.size()-2);
+        }
+
+        std::unique_ptr<TcpTransport> transport(new TcpTransport(host, address.substr(separator+1), DEFAULT_BAUDRATE, REPLY_TIMEOUT));
+        std::string error;
+        if ( !transport->connect(error) )
+        {
+            log << "Can't connect to \"" << portName << "\" : " << error << std::endl;
+            return nullptr;
+        }
+        return transport;
+#endif //_WIN32
+    }
+
+    if (portName == TRANSPORT_LOOPBACK_NAME)
+    {
+        EmulatorSettings settings;
+        settings.baudrate = 0;
+        return std::unique_ptr<Transport>(new LoopbackTransport(settings));
+    }
+
+    std::unique_ptr<SerialTransport> transport(new SerialTransport(portName, DEFAULT_BAUDRATE, REPLY_TIMEOUT));
+    if ( !transport->isOpen() )
+    {
+        log << "Can't open the port \""<< portName <<"\"" << std::endl;
+        return nullptr;
+    }
+    return transport;
+}
@@ -21,22 +21,32 @@
 #include <sstream>
 #include <vector>
 #include <string>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <csignal>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <fcntl.h>
+#endif //_WIN32
 
 #include "serial/serial.h"
 
 #include "C_string.hpp"
+#include "C_encoding.hpp"
 #include "C_checksum.hpp"
+#include "C_compression.hpp"
+#include "C_transfer.hpp"
+#include "C_options.hpp"
+#include "C_manifest.hpp"
+#include "C_image.hpp"
+#include "C_daemon.hpp"
+#include "C_trace.hpp"
+#include "C_log.hpp"
 #include "CMakeConfig.hpp"
 
-#define MAX_NUMOFDATA 100
-#define SECTOR_SIZE 4096
-
-enum MEMORY_MODEL : uint8_t
-{
-    MEMM_EEPROM = 0,
-    MEMM_FLASH  = 1
-};
-
 void ShowAllPorts()
 {
     std::vector<serial::PortInfo> devices = serial::list_ports();
@@ -47,12 +57,286 @@ void ShowAllPorts()
     }
 }
 
+bool FindBoardPorts(const std::string& boardId, uint32_t timeout, std::vector<std::string>& portNames, std::ostream& log)
+{
+    std::vector<serial::PortInfo> devices = serial::list_ports();
+    std::vector<std::string> informations(devices.size());
+    std::vector<char> found(devices.size(), 0);
+
+    log << "Searching a board on " << devices.size() << " port(s) ..." << std::endl;
+
+    //Every port is probed at the same time, the search takes one probe timeout whatever the number of ports
+    std::vector<std::thread> probes;
+    for (std::size_t i=0; i<devices.size(); ++i)
+    {
+        probes.emplace_back([&, i](){
+            try
+            {
+                SerialTransport port(devices[i].port, DEFAULT_BAUDRATE, timeout);
+                found[i] = port.isOpen() && ProbeBoard(port, timeout, boardId.empty() ? nullptr : &informations[i]);
+            }
+            catch (std::exception&)
+            {
+                //Busy or not a serial port
+                found[i] = 0;
+            }
+        });
+    }
+    for (std::thread& probe : probes)
+    {
+        probe.join();
+    }
+
+    portNames.clear();
+    for (std::size_t i=0; i<devices.size(); ++i)
+    {
+        //The board ID is a part of the board information or its identity (as in the manifest names)
+        if ( found[i] && (boardId.empty() || informations[i].find(boardId) != std::string::npos || GetBoardIdentity(informations[i]) == boardId) )
+        {
+            log << "Board found on \"" << devices[i].port << "\"" << std::endl;
+            portNames.push_back(devices[i].port);
+        }
+    }
+
+    if ( portNames.empty() )
+    {
+        log << "No board found" << (boardId.empty() ? "" : " matching \"" + boardId + "\"") << " !" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ReadInput(std::istream& input, std::vector<uint8_t>& data)
+{
+    //Read by blocks until the end, so pipes can be used as well as files
+    data.clear();
+    while (input)
+    {
+        std::size_t size = data.size();
+        data.resize(size + INPUT_BLOCK_SIZE);
+        input.read(reinterpret_cast<char*>(data.data()+size), INPUT_BLOCK_SIZE);
+        data.resize(size + input.gcount());
+    }
+    return input.eof();
+}
+bool LoadInputImage(const std::string& inputs, uint8_t format, MemoryImage& image, std::ostream& log)
+{
+    std::vector<std::string> splitedInputs;
+    Split(inputs, splitedInputs, ',');
+
+    image = MemoryImage();
+    for (const std::string& input : splitedInputs)
+    {
+        uint32_t address;
+        std::string path;
+        SplitImageInput(input, address, path);
+
+        std::ifstream fileIn;
+        std::istream* stream = &std::cin;
+        if (path == "-")
+        {
+#ifdef _WIN32
+            _setmode(_fileno(stdin), _O_BINARY);
+#endif //_WIN32
+        }
+        else
+        {
+            fileIn.open(path, std::ios::binary);
+            if ( !fileIn )
+            {
+                log << "Can't read the file \""<< path <<"\"" << std::endl;
+                return false;
+            }
+            stream = &fileIn;
+        }
+
+        //The standard input is a binary unless the format is given, it can't be detected without reading it
+        uint8_t inputFormat = format;
+        if (inputFormat == IMAGE_AUTO)
+        {
+            inputFormat = (path == "-") ? static_cast<uint8_t>(IMAGE_BINARY) : GetImageFormatFromPath(path);
+        }
+        if (inputFormat == IMAGE_AUTO)
+        {
+            inputFormat = DetectImageFormat(*stream);
+        }
+
+        const uint64_t loadedSize = GetRangesSize(image.segments);
+        switch (inputFormat)
+        {
+        case IMAGE_IHEX:
+            if ( !ParseIntelHex(*stream, address, image, log) )
+            {
+                log << "Can't load the Intel HEX file \""<< path <<"\"" << std::endl;
+                return false;
+            }
+            break;
+        case IMAGE_SREC:
+            if ( !ParseSRecord(*stream, address, image, log) )
+            {
+                log << "Can't load the S-record file \""<< path <<"\"" << std::endl;
+                return false;
+            }
+            break;
+        default:
+            {
+                std::vector<uint8_t> data;
+                if ( !ReadInput(*stream, data) )
+                {
+                    log << "Can't read " << (path == "-" ? std::string("the standard input") : "the file \"" + path + "\"") << std::endl;
+                    return false;
+                }
+                if ( !AddImageData(image, address, data.data(), data.size(), log) )
+                {
+                    return false;
+                }
+            }
+            break;
+        }
+
+        log << "Input \"" << path << "\" : " << GetImageFormatName(inputFormat) << ", " << (GetRangesSize(image.segments) - loadedSize) << " byte(s)";
+        if (address != 0)
+        {
+            log << (inputFormat == IMAGE_BINARY ? " at address " : " moved by ") << address;
+        }
+        log << std::endl;
+    }
+
+    if ( !FinishImage(image, log) )
+    {
+        return false;
+    }
+    if ( image.segments.empty() )
+    {
+        log << "The input has no data !" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<Transport> OpenPort(const std::string& portName, const TraceRecord& record, const std::vector<uint8_t>& input, std::ostream& log)
+{
+    std::unique_ptr<Transport> port = OpenTransport(portName, log);
+    if ( !port || record.path.empty() )
+    {
+        return port;
+    }
+
+    std::unique_ptr<RecordingTransport> recordingPort(new RecordingTransport(std::move(port), record.path));
+    if ( !recordingPort->start(record.options, input) )
+    {
+        log << "Can't write the trace \"" << record.path << "\" !" << std::endl;
+        return nullptr;
+    }
+    log << "Recording the port to \"" << record.path << "\"" << std::endl;
+    return recordingPort;
+}
+
+int TransferToPort(const std::string& portName, const std::vector<uint8_t>& fileData, const TransferSettings& settings, const TraceRecord& record, std::ostream& log, TransferStats& stats)
+{
+    const StatsClock::time_point start = StatsClock::now();
+    stats.port = portName;
+    stats.result = -1;
+
+    try
+    {
+        std::unique_ptr<Transport> port = OpenPort(portName, record, fileData, log);
+        if (port)
+        {
+            stats.result = TransferFile(*port, fileData, settings, log, &stats);
+        }
+    }
+    catch (std::exception& e)
+    {
+        log << "Serial error on the port \""<< portName <<"\" !" << std::endl;
+        log << e.what() << std::endl;
+        stats.result = -1;
+    }
+
+    stats.totalTime = std::chrono::duration_cast<std::chrono::microseconds>(StatsClock::now() - start).count();
+    return stats.result;
+}
+int DumpFromPort(const std::string& portName, uint32_t length, const TransferSettings& settings, const TraceRecord& record, std::vector<uint8_t>& data, uint32_t& sectorSize, std::ostream& log, TransferStats& stats)
+{
+    const StatsClock::time_point start = StatsClock::now();
+    stats.port = portName;
+    stats.result = -1;
+
+    try
+    {
+        std::unique_ptr<Transport> port = OpenPort(portName, record, std::vector<uint8_t>(), log);
+        BoardSession session;
+        if ( port && OpenSession(*port, settings, session, log, &stats) )
+        {
+            sectorSize = session.geometry.sectorSize;
+            stats.result = DumpMemory(*port, settings.startAddress, length, data, settings, session, log, &stats);
+        }
+    }
+    catch (std::exception& e)
+    {
+        log << "Serial error on the port \""<< portName <<"\" !" << std::endl;
+        log << e.what() << std::endl;
+        stats.result = -1;
+    }
+
+    stats.totalTime = std::chrono::duration_cast<std::chrono::microseconds>(StatsClock::now() - start).count();
+    return stats.result;
+}
+
+bool OutputStats(const std::vector<TransferStats>& stats, const std::string& statsPath)
+{
+    for (const TransferStats& portStats : stats)
+    {
+        std::cout << std::endl;
+        if (stats.size() > 1)
+        {
+            std::cout << "Statistics of \"" << portStats.port << "\" :" << std::endl;
+        }
+        PrintStats(portStats, std::cout);
+    }
+
+    if ( !statsPath.empty() )
+    {
+        std::ofstream statsFile(statsPath);
+        WriteStatsJson(stats, statsFile);
+        if (!statsFile)
+        {
+            std::cout << "Can't write the statistics to \"" << statsPath << "\" !" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifndef _WIN32
+namespace
+{
+
+std::atomic<bool> daemonRunning{true};
+
+void StopDaemon(int)
+{
+    daemonRunning = false;
+}
+
+} // namespace
+#endif //_WIN32
+
 void PrintHelp()
 {
     std::cout << "codeGTransfer usage :" << std::endl << std::endl;
 
-    std::cout << "Set the input file to be transfered" << std::endl;
-    std::cout << "\tcodeGTransfer --in=<path>" << std::endl << std::endl;
+    std::cout << "Set the input file to be transfered, - to read it from the standard input (pipe)" << std::endl;
+    std::cout << "\tmany inputs can be given, a binary is placed at its address and the address is added to the ones of an Intel HEX or S-record file" << std::endl;
+    std::cout << "\tcodeGTransfer --in=<path>" << std::endl;
+    std::cout << "\tcodeGTransfer --in=[<address>:]<path>,[<address>:]<path>,..." << std::endl << std::endl;
+
+    std::cout << "Set the format of the inputs (must be auto, binary, ihex or srec) default to auto" << std::endl;
+    std::cout << "\tauto : from the extension (.hex .ihex .ihx, .srec .s19 .s28 .s37 .mot, .bin .cg) or else from the first line, the standard input is a binary" << std::endl;
+    std::cout << "\tcodeGTransfer --format=<name>" << std::endl << std::endl;
+
+    std::cout << "Only transfer these ranges of the input, set from the input when it has holes" << std::endl;
+    std::cout << "\tcodeGTransfer --segments=<address>+<size>,..." << std::endl << std::endl;
 
     std::cout << "Set the memory model (must be eeprom, flash or default) default to eeprom" << std::endl;
     std::cout << "\tcodeGTransfer --model=<name>" << std::endl << std::endl;
@@ -66,8 +350,100 @@ void PrintHelp()
     std::cout << "Set the start address, default 0" << std::endl;
     std::cout << "\tcodeGTransfer --start=<number>" << std::endl << std::endl;
 
-    std::cout << "Set the port name" << std::endl;
-    std::cout << "\tcodeGTransfer --port=<name>" << std::endl << std::endl;
+    std::cout << "Set the number of write frames in flight (1 to " << MAX_WINDOWSIZE << "), default 1 (stop-and-wait)" << std::endl;
+    std::cout << "\tcodeGTransfer --window=<number>" << std::endl << std::endl;
+
+    std::cout << "Erase the flash sector by sector while writing, up to <number> sector(s) ahead of the write cursor (0 to " << MAX_ERASEAHEAD << "), default 0 (every sector is erased first)" << std::endl;
+    std::cout << "\tcodeGTransfer --eraseAhead=<number>" << std::endl << std::endl;
+
+    std::cout << "Set when the data is read back (must be immediate, deferred or crc) default to immediate" << std::endl;
+    std::cout << "\timmediate : every chunk is read back right after being written" << std::endl;
+    std::cout << "\tdeferred : the whole file is written first and then read back in large blocks" << std::endl;
+    std::cout << "\tcrc : the whole file is written first and then the board returns a CRC of the written ranges (the board must support it)" << std::endl;
+    std::cout << "\tcodeGTransfer --verifyMode=<name>" << std::endl << std::endl;
+
+    std::cout << "Set the size of a read back block in deferred mode, default " << DEFAULT_VERIFYBLOCK << std::endl;
+    std::cout << "\tcodeGTransfer --verifyBlock=<number>" << std::endl << std::endl;
+
+    std::cout << "Set the data encoding (must be auto, decimal, hex or binary) default to auto" << std::endl;
+    std::cout << "\tauto : the densest encoding advertised by the board is used" << std::endl;
+    std::cout << "\tcodeGTransfer --encoding=<name>" << std::endl << std::endl;
+
+    std::cout << "Set the checksum of the write frames and of the read replies (must be auto, sum or crc32) default to auto" << std::endl;
+    std::cout << "\tauto : the CRC-32 is used when the board advertises it" << std::endl;
+    std::cout << "\tcodeGTransfer --checksum=<name>" << std::endl << std::endl;
+
+    std::cout << "Set the compression of the write frames (must be auto, none, rle or lz) default to auto" << std::endl;
+    std::cout << "\tauto : every compression advertised by the board is tried, the shortest frame is sent (plain included)" << std::endl;
+    std::cout << "\tcodeGTransfer --compression=<name>" << std::endl << std::endl;
+
+    std::cout << "Negotiate a faster baudrate with the board after the connection at " << DEFAULT_BAUDRATE << " baud" << std::endl;
+    std::cout << "\tmax : the fastest baudrate advertised by the board" << std::endl;
+    std::cout << "\tcodeGTransfer --baud=<number or max>" << std::endl << std::endl;
+
+    std::cout << "Enable the RTS/CTS hardware flow control (the board must support it)" << std::endl;
+    std::cout << "\tcodeGTransfer --rtscts" << std::endl << std::endl;
+
+    std::cout << "Only erase and write the sectors that changed since the last transfer" << std::endl;
+    std::cout << "\tthe sectors are compared with the board manifest, or read back from the board when there is no manifest" << std::endl;
+    std::cout << "\tcodeGTransfer --delta" << std::endl << std::endl;
+
+    std::cout << "Same as --delta but always read back the sectors from the board" << std::endl;
+    std::cout << "\tcodeGTransfer --delta=readback" << std::endl << std::endl;
+
+    std::cout << "Set the directory where the board manifests and the transfer journals are kept, default to the working directory" << std::endl;
+    std::cout << "\tcodeGTransfer --manifestDir=<path>" << std::endl << std::endl;
+
+    std::cout << "Skip the write and the read back of the chunks that only contain the erased value (0xFF)," << std::endl;
+    std::cout << "\tthey are blank checked at the end instead (flash only)" << std::endl;
+    std::cout << "\tcodeGTransfer --sparse" << std::endl << std::endl;
+
+    std::cout << "Set the number of retries of a chunk after a bad reply, the board is resynchronised before, default " << DEFAULT_RETRYCOUNT << std::endl;
+    std::cout << "\tcodeGTransfer --retry=<number>" << std::endl << std::endl;
+
+    std::cout << "Resume an interrupted transfer of the same file on the same port and board from its journal, only the sectors not erased yet are erased" << std::endl;
+    std::cout << "\tcodeGTransfer --resume" << std::endl << std::endl;
+
+    std::cout << "Print the timings of the transfer phases, the latency of every command and the throughput at the end," << std::endl;
+    std::cout << "\tthey are also written as JSON to the path if one is given" << std::endl;
+    std::cout << "\tcodeGTransfer --stats" << std::endl;
+    std::cout << "\tcodeGTransfer --stats=<path>" << std::endl << std::endl;
+
+    std::cout << "Don't log every chunk, only the progress every 10% and the errors" << std::endl;
+    std::cout << "\tcodeGTransfer --quiet" << std::endl << std::endl;
+
+    std::cout << "Record every frame sent and received with its time in a binary trace, to analyse or replay it with codeGTransferReplay" << std::endl;
+    std::cout << "\twith several ports, the index of the port is appended to the path (<path>.0, <path>.1, ...)" << std::endl;
+    std::cout << "\tcodeGTransfer --record=<path>" << std::endl << std::endl;
+
+    std::cout << "Read the board memory to a file instead of transfering a file, from the start address (--start)" << std::endl;
+    std::cout << "\tthe range is read with up to --window requests in flight, the blocks with a bad reply are read again" << std::endl;
+    std::cout << "\tcodeGTransfer --dump=<path> --length=<number>" << std::endl << std::endl;
+
+    std::cout << "Set the size of a read request of a dump, default " << DEFAULT_DUMPBLOCK << std::endl;
+    std::cout << "\tcodeGTransfer --dumpBlock=<number>" << std::endl << std::endl;
+
+    std::cout << "Also write the hash of every sector of a dump, to compare the memory of many boards" << std::endl;
+    std::cout << "\tcodeGTransfer --hashes=<path>" << std::endl << std::endl;
+
+    std::cout << "Set the port name, many ports can be given to transfer the file to many boards at the same time" << std::endl;
+    std::cout << "\tcodeGTransfer --port=<name>" << std::endl;
+    std::cout << "\tcodeGTransfer --port=<name,name,...>" << std::endl;
+    std::cout << "\ta serial port server can be reached with tcp://<host>:<port> (raw mode, the baudrate is the one of the server)," << std::endl;
+    std::cout << "\tloopback is an emulated board in memory" << std::endl << std::endl;
+
+    std::cout << "Search the boards on every available port, all the ports answering the hello are used" << std::endl;
+    std::cout << "\tthe ports are probed at the same time, each one has up to the probe timeout to answer (ms, default " << PROBE_TIMEOUT << ")," << std::endl;
+    std::cout << "\tonly the boards whose information (or identity) contains the board ID are kept if one is given" << std::endl;
+    std::cout << "\tcodeGTransfer --port=auto" << std::endl;
+    std::cout << "\tcodeGTransfer --port=auto --boardId=<text> --probeTimeout=<number>" << std::endl << std::endl;
+
+    std::cout << "Run as a daemon that keeps the ports and the board sessions opened, the jobs are received on the unix socket" << std::endl;
+    std::cout << "\tthe baudrate, flow control, encoding and checksum options of the daemon are used for all the jobs (no input file)" << std::endl;
+    std::cout << "\tcodeGTransfer --daemon=<socket> --port=<name,...>" << std::endl << std::endl;
+
+    std::cout << "Send the transfer to a daemon instead of opening the port, the port can be omitted when the daemon has only one" << std::endl;
+    std::cout << "\tcodeGTransfer --socket=<socket>" << std::endl << std::endl;
 
     std::cout << "Print all the available ports (and do nothing else)" << std::endl;
     std::cout << "\tcodeGTransfer --showPorts" << std::endl << std::endl;
@@ -88,16 +464,21 @@ void PrintVersion()
 
 int main(int argc, char **argv)
 {
-    std::string portName;
+    std::vector<std::string> portNames;
     std::string fileInPath;
-    uint8_t memoryModel = MEMM_EEPROM;
-    uint32_t startAddress = 0;
-
-    std::string transmitBuffer;
-    std::string receiveBuffer;
-
-    bool enableWrite = true;
-    bool enableFlashErase = true;
+    TransferSettings settings;
+    bool printStats = false;
+    std::string statsPath;
+    std::string daemonPath;
+    std::string socketPath;
+    std::vector<std::string> jobOptions;
+    std::string dumpPath;
+    std::string hashesPath;
+    uint64_t dumpLength = 0;
+    std::string recordPath;
+    std::string boardId;
+    uint32_t probeTimeout = PROBE_TIMEOUT;
+    uint8_t inputFormat = IMAGE_AUTO;
 
     std::vector<std::string> commands(argv, argv + argc);
 
@@ -131,18 +512,27 @@ int main(int argc, char **argv)
             std::getline(std::cin, fileInPath);
 
             ShowAllPorts();
-            std::cout << "Please insert the port name"<< std::endl <<"> ";
-            std::getline(std::cin, fileInPath);
+            std::cout << "Please insert the port name (or auto)"<< std::endl <<"> ";
+            std::string portName;
+            std::getline(std::cin, portName);
+            portNames.clear();
+            Split(portName, portNames, ',');
             continue;
         }
-        if (commands[i] == "--verify")
+        switch ( ParseTransferOption(commands[i], settings, std::cout) )
         {
-            enableWrite = false;
+        case OPTION_PARSED:
+            jobOptions.push_back(commands[i]);
             continue;
+        case OPTION_ERROR:
+            return -1;
+        default:
+            break;
         }
-        if (commands[i] == "--noErase")
+
+        if (commands[i] == "--stats")
         {
-            enableFlashErase = false;
+            printStats = true;
             continue;
         }
 
@@ -157,37 +547,62 @@ int main(int argc, char **argv)
                 fileInPath = splitedCommand[1];
                 continue;
             }
+            if ( splitedCommand[0] == "--format")
+            {
+                inputFormat = GetImageFormat(splitedCommand[1]);
+                if (inputFormat == IMAGE_UNKNOWN)
+                {
+                    std::cout << "Unknown input format : \""<< splitedCommand[1] <<"\" !" << std::endl;
+                    return -1;
+                }
+                continue;
+            }
             if ( splitedCommand[0] == "--port")
             {
-                portName = splitedCommand[1];
+                portNames.clear();
+                Split(splitedCommand[1], portNames, ',');
                 continue;
             }
-            if ( splitedCommand[0] == "--model")
+            if ( splitedCommand[0] == "--stats")
             {
-                if (splitedCommand[1] == "eeprom")
-                {
-                    memoryModel = MEMM_EEPROM;
-                }
-                else if (splitedCommand[1] == "flash")
-                {
-                    memoryModel = MEMM_FLASH;
-                }
-                else if (splitedCommand[1] == "default")
+                printStats = true;
+                statsPath = splitedCommand[1];
+                continue;
+            }
+            if ( splitedCommand[0] == "--dump")
+            {
+                dumpPath = splitedCommand[1];
+                continue;
+            }
+            if ( splitedCommand[0] == "--hashes")
+            {
+                hashesPath = splitedCommand[1];
+                continue;
+            }
+            if ( splitedCommand[0] == "--length")
+            {
+                try
                 {
-                    memoryModel = MEMM_EEPROM;
+                    dumpLength = std::stoull(splitedCommand[1]);
                 }
-                else
+                catch (std::exception& e)
                 {
-                    std::cout << "Unknown memory model : \""<< splitedCommand[1] <<"\" !" << std::endl;
+                    std::cout << "Can't convert \""<< splitedCommand[1] << "\" as a number !" << std::endl;
+                    std::cout << e.what() << std::endl;
                     return -1;
                 }
                 continue;
             }
-            if ( splitedCommand[0] == "--start")
+            if ( splitedCommand[0] == "--boardId")
+            {
+                boardId = splitedCommand[1];
+                continue;
+            }
+            if ( splitedCommand[0] == "--probeTimeout")
             {
                 try
                 {
-                    startAddress = std::stoul(splitedCommand[1]);
+                    probeTimeout = std::stoul(splitedCommand[1]);
                 }
                 catch (std::exception& e)
                 {
@@ -197,6 +612,21 @@ int main(int argc, char **argv)
                 }
                 continue;
             }
+            if ( splitedCommand[0] == "--record")
+            {
+                recordPath = splitedCommand[1];
+                continue;
+            }
+            if ( splitedCommand[0] == "--daemon")
+            {
+                daemonPath = splitedCommand[1];
+                continue;
+            }
+            if ( splitedCommand[0] == "--socket")
+            {
+                socketPath = splitedCommand[1];
+                continue;
+            }
         }
 
         //Unknown command
@@ -204,223 +634,328 @@ int main(int argc, char **argv)
         return -1;
     }
 
-    if ( fileInPath.empty() )
+    if ( !CheckTransferSettings(settings, std::cout) )
     {
-        std::cout << "No input file !" << std::endl;
         return -1;
     }
-    if ( portName.empty() )
+
+    if ( portNames.size() == 1 && portNames[0] == PORT_AUTO )
     {
-        std::cout << "Undefined port !" << std::endl;
+        if ( !socketPath.empty() )
+        {
+            std::cout << "The ports of a daemon can't be searched !" << std::endl;
+            return -1;
+        }
+        if ( !FindBoardPorts(boardId, probeTimeout, portNames, std::cout) )
+        {
+            return -1;
+        }
+        std::cout << std::endl;
+    }
+    else if ( !boardId.empty() )
+    {
+        std::cout << "A board ID is only used with --port=" PORT_AUTO " !" << std::endl;
         return -1;
     }
 
-    std::cout << "Input file : \""<< fileInPath <<"\"" << std::endl;
-    std::cout << "Port name : \""<< portName <<"\"" << std::endl;
-
-    ///Opening file
-    std::ifstream fileIn( fileInPath, std::ios::binary | std::ios::ate); //get the file size
-    if ( !fileIn )
+    if ( !recordPath.empty() && (!daemonPath.empty() || !socketPath.empty()) )
     {
-        std::cout << "Can't read the file \""<< fileInPath <<"\"" << std::endl;
+        std::cout << "The daemon ports can't be recorded !" << std::endl;
         return -1;
     }
-    std::ifstream::pos_type fileSize = fileIn.tellg();
-
-    fileIn.clear();
 
-    if (startAddress >= fileSize)
+    if ( !daemonPath.empty() )
     {
-        std::cout << "Can't start at address "<< startAddress <<", the file size is only "<< fileSize <<" bytes !" << std::endl;
+#ifdef _WIN32
+        std::cout << "The daemon is not available on Windows !" << std::endl;
         return -1;
-    }
+#else
+        if ( portNames.empty() )
+        {
+            std::cout << "Undefined port !" << std::endl;
+            return -1;
+        }
+
+        DaemonSettings daemonSettings;
+        daemonSettings.socketPath = daemonPath;
+        daemonSettings.portNames = portNames;
+        daemonSettings.settings = settings;
 
-    fileIn.seekg(startAddress); //Return to the start address
-    std::cout << "Starting address : " << startAddress << std::endl;
+        std::signal(SIGINT, StopDaemon);
+        std::signal(SIGTERM, StopDaemon);
+        std::signal(SIGPIPE, SIG_IGN);
 
-    ///Opening port
-    serial::Serial port(portName, 9600, serial::Timeout(50, 4000, 0, 4000, 0),
-                        serial::bytesize_t::eightbits,
-                        serial::parity_t::parity_none,
-                        serial::stopbits_t::stopbits_one,
-                        serial::flowcontrol_t::flowcontrol_none);
+        return RunDaemon(daemonSettings, daemonRunning, std::cout);
+#endif //_WIN32
+    }
 
-    if( !port.isOpen() )
+    if ( !socketPath.empty() )
     {
-        std::cout << "Can't open the port \""<< portName <<"\"" << std::endl;
+#ifdef _WIN32
+        std::cout << "The daemon is not available on Windows !" << std::endl;
         return -1;
+#endif //_WIN32
+        if ( !statsPath.empty() )
+        {
+            std::cout << "The statistics of a daemon job can't be written to a file !" << std::endl;
+            return -1;
+        }
     }
 
-    std::cout << std::endl;
+    if ( !dumpPath.empty() )
+    {
+        if ( !fileInPath.empty() )
+        {
+            std::cout << "A dump doesn't have an input file !" << std::endl;
+            return -1;
+        }
+        if (dumpLength == 0 || static_cast<uint64_t>(settings.startAddress) + dumpLength > MAX_IMAGE_SIZE)
+        {
+            std::cout << "The dump length must be given and the range must end before the last address of the frames (" << (MAX_IMAGE_SIZE-1) << ") !" << std::endl;
+            return -1;
+        }
+        if (portNames.size() > 1)
+        {
+            std::cout << "Only one board can be dumped at a time !" << std::endl;
+            return -1;
+        }
+        if ( portNames.empty() && socketPath.empty() )
+        {
+            std::cout << "Undefined port !" << std::endl;
+            return -1;
+        }
 
-    std::cout << "Saying hello ... ";
+        std::cout << "Dump file : \""<< dumpPath <<"\"" << std::endl;
+        if ( !portNames.empty() )
+        {
+            std::cout << "Port name : \""<< portNames[0] <<"\"" << std::endl;
+        }
+        std::cout << std::endl;
 
-    port.write("$H#");
-    receiveBuffer = port.read(20);
+        std::vector<uint8_t> dumpData;
+        uint32_t sectorSize = 0;
+        std::vector<TransferStats> stats(1);
+        int result = -1;
 
-    std::cout << receiveBuffer << std::endl;
-    if (receiveBuffer != "HELLO\n")
-    {
-        std::cout << "The board didn't respond or sent a bad response !" << std::endl;
-        return -1;
-    }
+        if ( socketPath.empty() )
+        {
+            TraceRecord record;
+            record.path = recordPath;
+            record.options = jobOptions;
+            record.options.push_back("--dump");
+            record.options.push_back("--length=" + std::to_string(dumpLength));
 
-    std::cout << "Get board information ... ";
+            result = DumpFromPort(portNames[0], static_cast<uint32_t>(dumpLength), settings, record, dumpData, sectorSize, std::cout, stats[0]);
+        }
+#ifndef _WIN32
+        else
+        {
+            std::vector<std::string> options = jobOptions;
+            options.push_back("--dump");
+            options.push_back("--length=" + std::to_string(dumpLength));
+            if ( !portNames.empty() )
+            {
+                options.push_back("--port=" + portNames[0]);
+            }
+            if (printStats)
+            {
+                options.push_back("--stats");
+            }
 
-    port.write("$I#");
-    receiveBuffer = port.read(100);
+            DaemonDump dump;
+            result = SendDaemonJob(socketPath, options, std::vector<uint8_t>(), std::cout, &dump);
+            dumpData = std::move(dump.data);
+            sectorSize = dump.sectorSize;
+        }
+#endif //_WIN32
 
-    std::cout << std::endl << receiveBuffer << std::endl;
-    if (receiveBuffer.empty())
-    {
-        std::cout << "The board didn't respond !" << std::endl;
-        return -1;
-    }
+        if (result != 0)
+        {
+            return -1;
+        }
 
-    std::cout << "Set memory model ... ";
+        std::ofstream dumpFile(dumpPath, std::ios::binary | std::ios::trunc);
+        dumpFile.write(reinterpret_cast<const char*>(dumpData.data()), dumpData.size());
+        if (!dumpFile)
+        {
+            std::cout << "Can't write the dump to \"" << dumpPath << "\" !" << std::endl;
+            return -1;
+        }
+        std::cout << dumpData.size() << " byte(s) written to \"" << dumpPath << "\"" << std::endl;
 
-    transmitBuffer = "$Mx#";
-    transmitBuffer[2] = memoryModel + '0';
-    port.write(transmitBuffer);
-    receiveBuffer = port.read(20);
+        if ( !hashesPath.empty() )
+        {
+            SectorHashMap sectors;
+            HashSectors(dumpData.data(), settings.startAddress, dumpData.size(), sectorSize, sectors);
+            if ( !SaveSectorHashes(hashesPath, sectorSize, sectors) )
+            {
+                std::cout << "Can't write the sector hashes to \"" << hashesPath << "\" !" << std::endl;
+                return -1;
+            }
+            std::cout << sectors.size() << " sector hash(es) written to \"" << hashesPath << "\"" << std::endl;
+        }
 
-    std::cout << receiveBuffer << std::endl;
-    if (receiveBuffer.size() == 2)
-    {
-        if ((receiveBuffer[0]-'0') != memoryModel)
+        if ( printStats && socketPath.empty() && !OutputStats(stats, statsPath) )
         {
-            std::cout << "The board returned a bad memory model !" << std::endl;
             return -1;
         }
+        return 0;
     }
-    else
+
+    if ( fileInPath.empty() )
     {
-        std::cout << "The board didn't respond or sent a bad response !" << std::endl;
+        std::cout << "No input file !" << std::endl;
         return -1;
     }
-
-    std::cout << std::endl;
-
-    if (enableWrite)
+    if ( portNames.empty() )
     {
-        if (memoryModel == MEMM_FLASH)
+        if ( socketPath.empty() )
         {
-            if (enableFlashErase)
-            {
-                uint8_t startSector = 0;
-                uint8_t countSector = (fileSize/SECTOR_SIZE) + 1;
-
-                std::cout << "Erasing from sector "<< static_cast<int>(startSector) <<" to sector " << static_cast<int>(startSector+countSector) << " ..."  << std::endl;
-                transmitBuffer = "$FES";
-                PushUint8InString(startSector, transmitBuffer);
-                PushUint8InString(countSector, transmitBuffer);
-                transmitBuffer += '#';
-
-                port.write(transmitBuffer);
-                receiveBuffer = port.read(40);
-                std::cout << receiveBuffer << std::endl;
-                if (receiveBuffer.find("ERASED") == std::string::npos)
-                {
-                    std::cout << "The board didn't respond or sent a bad response !" << std::endl;
-                    return -1;
-                }
-            }
-            else
-            {
-                std::cout << "Flash erase skipped" << std::endl;
-            }
+            std::cout << "Undefined port !" << std::endl;
+            return -1;
         }
+        //The daemon picks its only port
+        portNames.emplace_back();
+    }
 
-        std::cout << "Write and verify a total of " << fileSize << " byte(s) ..." << std::endl << std::endl;
+    std::cout << "Input file : \""<< fileInPath <<"\"" << std::endl;
+    if ( !socketPath.empty() )
+    {
+        std::cout << "Daemon socket : \""<< socketPath <<"\"" << std::endl;
     }
-    else
+    for (const std::string& portName : portNames)
     {
-        std::cout << "Write skipped" << std::endl;
-        std::cout << "Verify only a total of " << fileSize << " byte(s) ..." << std::endl << std::endl;
+        if ( !portName.empty() )
+        {
+            std::cout << "Port name : \""<< portName <<"\"" << std::endl;
+        }
     }
 
-    uint8_t dataBuffer[MAX_NUMOFDATA];
-
-    while ( fileIn.good() )
+    ///Reading file
+    MemoryImage image;
+    if ( !LoadInputImage(fileInPath, inputFormat, image, std::cout) )
     {
-        std::cout << (startAddress*100)/fileSize << "% done ..." << std::endl;
-
-        transmitBuffer = "$W";
-        std::string dataReadCompare;
-        uint8_t numOfData = 0;
-        uint8_t checksum = 0;
+        return -1;
+    }
 
-        fileIn.read(reinterpret_cast<char*>(dataBuffer), MAX_NUMOFDATA);
-        numOfData = fileIn.gcount();
-        if (numOfData == 0)
+    //A segmented image is sent flat with its segments, so the daemon jobs and the traces get them too
+    if ( !IsFlatImage(image) )
+    {
+        if ( !settings.segments.empty() )
         {
-            continue;
+            std::cout << "The segments are already given by the input !" << std::endl;
+            return -1;
         }
+        settings.segments = image.segments;
+        jobOptions.push_back(GetSegmentsOption(image.segments));
+    }
+    std::vector<uint8_t> fileData = std::move(image.data);
+
+    if (settings.startAddress >= fileData.size())
+    {
+        std::cout << "Can't start at address "<< settings.startAddress <<", the file size is only "<< fileData.size() <<" bytes !" << std::endl;
+        return -1;
+    }
 
-        checksum = CalculateChecksum(dataBuffer, numOfData); //Calculate checksum
+    std::cout << "Starting address : " << settings.startAddress << std::endl;
 
-        PushUint8InString(checksum, transmitBuffer); //Push checksum
-        PushUint8InString(checksum, dataReadCompare);
-        PushUint24InString(startAddress, transmitBuffer); //Push start address
-        PushUint24InString(startAddress, dataReadCompare);
+    if ( !CheckRanges(settings.segments, fileData.size()) )
+    {
+        std::cout << "The segments must be sorted without overlap and within the file data !" << std::endl;
+        return -1;
+    }
 
-        for (unsigned int i=0; i<numOfData; ++i)
+#ifndef _WIN32
+    //The daemon only gets the bytes of the segments, not the holes between them
+    std::vector<uint8_t> packedData;
+    const std::vector<uint8_t>* jobData = &fileData;
+    if ( !socketPath.empty() )
+    {
+        if ( !settings.segments.empty() )
         {
-            PushUint8InString(dataBuffer[i], transmitBuffer); //Push data
-            PushUint8InString(dataBuffer[i], dataReadCompare);
+            PackSegments(fileData, settings.segments, packedData);
+            jobData = &packedData;
         }
-        transmitBuffer += '#';
 
-        ///Writing
-        if (enableWrite)
+        if (jobData->size() > DAEMON_MAX_DATASIZE)
         {
-            std::cout << "Writing " << static_cast<unsigned int>(numOfData) << " byte(s) of data at address " << startAddress << " ... ";
-
-            port.write(transmitBuffer);
+            std::cout << "The daemon jobs are limited to " << DAEMON_MAX_DATASIZE << " bytes of data, the input has " << jobData->size() << " bytes !" << std::endl;
+            return -1;
+        }
+    }
+#endif //_WIN32
 
-            receiveBuffer = port.read(20);
+    std::vector<TransferStats> stats(portNames.size());
+    int result = 0;
 
-            std::cout << receiveBuffer << std::endl;
-            if (receiveBuffer != "WRITED\n")
+    auto transfer = [&](std::size_t i, std::ostream& log){
+#ifndef _WIN32
+        if ( !socketPath.empty() )
+        {
+            //The daemon prints the statistics in the job log
+            std::vector<std::string> options = jobOptions;
+            if ( !portNames[i].empty() )
             {
-                std::cout << "The board didn't respond or sent a bad response !" << std::endl;
-                return -1;
+                options.push_back("--port=" + portNames[i]);
+            }
+            if (printStats)
+            {
+                options.push_back("--stats");
             }
+            stats[i].port = portNames[i];
+            stats[i].result = SendDaemonJob(socketPath, options, *jobData, log);
+            return stats[i].result;
         }
+#endif //_WIN32
+        TraceRecord record;
+        record.options = jobOptions;
+        if ( !recordPath.empty() )
+        {
+            record.path = (portNames.size() == 1) ? recordPath : recordPath + "." + std::to_string(i);
+        }
+        return TransferToPort(portNames[i], fileData, settings, record, log, stats[i]);
+    };
 
-        ///Reading
-
-        std::cout << "Reading " << static_cast<unsigned int>(numOfData) << " byte(s) at address " << startAddress << " ... " << std::endl;
-
-        transmitBuffer = "$R";
-        PushUint24InString(startAddress, transmitBuffer); //Push start address
-        PushUint24InString(numOfData, transmitBuffer); //Push num of data
-        transmitBuffer += '#';
-
-        port.write(transmitBuffer);
+    if (portNames.size() == 1)
+    {
+        std::cout << std::endl;
+        result = transfer(0, std::cout);
+    }
+    else
+    {
+        ///Gang transfer, one worker per port sharing the same file data
+        std::cout << "Transfering to " << portNames.size() << " boards ..." << std::endl << std::endl;
 
-        receiveBuffer = port.read(500);
+        std::mutex logMutex;
+        std::vector<std::thread> workers;
 
-        std::cout << receiveBuffer << std::endl;
-        if ( receiveBuffer.size() != static_cast<unsigned int>(18+numOfData*3) )
+        for (std::size_t i=0; i<portNames.size(); ++i)
         {
-            std::cout << "The board didn't respond or sent a bad response !" << std::endl;
-            return -1;
+            workers.emplace_back([&, i](){
+                PrefixedLogBuffer logBuffer(std::cout, logMutex, "[" + portNames[i] + "] ");
+                std::ostream log(&logBuffer);
+                transfer(i, log);
+            });
         }
-        receiveBuffer.erase(0, 6);
-        receiveBuffer.pop_back();
-
-        ///Compare
-        if ( receiveBuffer != dataReadCompare )
+        for (std::thread& worker : workers)
         {
-            std::cout << "The board didn't do a successfully write/read to the memory !" << std::endl;
-            return -1;
+            worker.join();
         }
 
-        startAddress += numOfData;
+        std::cout << std::endl << "Results :" << std::endl;
+        for (const TransferStats& portStats : stats)
+        {
+            std::cout << "\t" << portStats.port << " : " << (portStats.result == 0 ? "OK" : "FAILED") << std::endl;
+            if (portStats.result != 0)
+            {
+                result = -1;
+            }
+        }
     }
 
-    std::cout << "The board successfully write/read to the memory !" << std::endl;
-
-    return 0;
+    if ( printStats && socketPath.empty() && !OutputStats(stats, statsPath) )
+    {
+        return -1;
+    }
+    return result;
 }
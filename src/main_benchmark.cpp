@@ -0,0 +1,414 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#include <unistd.h>
+
+#include "C_string.hpp"
+#include "C_transfer.hpp"
+#include "C_emulator.hpp"
+#include "C_transport.hpp"
+#include "CMakeConfig.hpp"
+
+#define DEFAULT_BENCHMARK_BAUDRATE 115200
+
+namespace
+{
+
+struct BenchmarkProfile
+{
+    const char* _name;
+    unsigned int _windowSize;
+    uint8_t _verifyMode;
+    bool _autoEncoding;
+    bool _autoCompression;
+    unsigned int _eraseAhead;
+};
+
+const BenchmarkProfile gProfiles[] = {
+    {"stop-and-wait",           1, VERIFY_IMMEDIATE, false, false, 0},
+    {"window 8",                8, VERIFY_IMMEDIATE, false, false, 0},
+    {"window 8 deferred",       8, VERIFY_DEFERRED,  false, false, 0},
+    {"window 8 deferred auto",  8, VERIFY_DEFERRED,  true,  false, 0},
+    {"window 8 crc auto",       8, VERIFY_CRC,       true,  false, 0},
+    {"window 8 crc compressed", 8, VERIFY_CRC,       true,  true,  0},
+    {"window 8 crc erase ahead",8, VERIFY_CRC,       true,  true,  1}
+};
+
+bool GetNumberArgument(const std::string& str, uint32_t& value)
+{
+    try
+    {
+        value = std::stoul(str);
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "Can't convert \""<< str << "\" as a number !" << std::endl;
+        std::cout << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//Code like image : a few recurring instructions, some with a random operand, and padding between the functions
+void FillCodeImage(std::mt19937& generator, std::vector<uint8_t>& data)
+{
+    std::size_t i = 0;
+    while (i < data.size())
+    {
+        if (generator()%16 == 0)
+        {
+            const std::size_t padding = 16 + generator()%112;
+            for (std::size_t j=0; j<padding && i<data.size(); ++j)
+            {
+                data[i++] = 0xFF;
+            }
+            continue;
+        }
+
+        const uint8_t opcode = static_cast<uint8_t>(0x10 + generator()%24);
+        data[i++] = opcode;
+        if (i < data.size())
+        {
+            data[i++] = (opcode & 1) ? static_cast<uint8_t>(generator()) : 0x00;
+        }
+    }
+}
+
+void PrintPercentiles(const std::string& name, const std::vector<uint32_t>& samples)
+{
+    std::cout << "\t" << std::left << std::setw(12) << name << std::right
+              << std::setw(8) << samples.size() << " sample(s)"
+              << "  p50 " << std::setw(8) << GetPercentile(samples, 50)
+              << "  p90 " << std::setw(8) << GetPercentile(samples, 90)
+              << "  p99 " << std::setw(8) << GetPercentile(samples, 99) << " us" << std::endl;
+}
+
+//The transfer run against a pseudo-terminal served by the emulator, with the wire latency
+int RunPseudoTerminal(const TransferSettings& settings, const std::vector<uint8_t>& fileData, const EmulatorSettings& emulatorSettings,
+                      EmulatorStats& stats, std::chrono::steady_clock::duration& elapsed)
+{
+    Emulator emulator(emulatorSettings);
+
+    int masterFd;
+    int slaveFd;
+    std::string slavePath;
+    if ( !OpenPseudoTerminal(masterFd, slaveFd, slavePath) )
+    {
+        std::cout << "Can't open a pseudo-terminal !" << std::endl;
+        return -1;
+    }
+
+    std::atomic<bool> running{true};
+    std::thread emulatorThread(RunEmulator, std::ref(emulator), masterFd, std::cref(running), std::ref(stats));
+
+    //The transfer output is discarded
+    std::ostream nullLog(nullptr);
+
+    int result;
+    {
+        SerialTransport port(slavePath, DEFAULT_BAUDRATE, REPLY_TIMEOUT);
+
+        auto startTime = std::chrono::steady_clock::now();
+        result = TransferFile(port, fileData, settings, nullLog);
+        elapsed = std::chrono::steady_clock::now() - startTime;
+    }
+
+    running = false;
+    emulatorThread.join();
+    close(slaveFd);
+    close(masterFd);
+
+    const std::vector<uint8_t>& memory = emulator.getMemory(settings.memoryModel);
+    if ( result == 0 && !std::equal(fileData.begin(), fileData.end(), memory.begin()) )
+    {
+        result = -1;
+    }
+    return result;
+}
+
+//The transfer run against the in-memory loopback, only the time spent by the host is left
+int RunLoopback(const TransferSettings& settings, const std::vector<uint8_t>& fileData, const EmulatorSettings& emulatorSettings,
+                TransferStats& stats, std::chrono::steady_clock::duration& elapsed)
+{
+    LoopbackTransport port(emulatorSettings);
+    std::ostream nullLog(nullptr);
+
+    auto startTime = std::chrono::steady_clock::now();
+    int result = TransferFile(port, fileData, settings, nullLog, &stats);
+    elapsed = std::chrono::steady_clock::now() - startTime;
+
+    const std::vector<uint8_t>& memory = port.getEmulator().getMemory(settings.memoryModel);
+    if ( result == 0 && !std::equal(fileData.begin(), fileData.end(), memory.begin()) )
+    {
+        result = -1;
+    }
+    return result;
+}
+
+int RunBenchmark(const BenchmarkProfile& profile, const std::vector<uint8_t>& fileData, uint8_t memoryModel, const EmulatorSettings& emulatorSettings, bool loopback)
+{
+    TransferSettings settings;
+    settings.memoryModel = memoryModel;
+    settings.windowSize = profile._windowSize;
+    settings.verifyMode = profile._verifyMode;
+    settings.autoEncoding = profile._autoEncoding;
+    settings.autoCompression = profile._autoCompression;
+    settings.eraseAhead = profile._eraseAhead;
+
+    EmulatorStats stats;
+    TransferStats transferStats;
+    std::chrono::steady_clock::duration elapsed;
+
+    const int result = loopback ? RunLoopback(settings, fileData, emulatorSettings, transferStats, elapsed) :
+                                  RunPseudoTerminal(settings, fileData, emulatorSettings, stats, elapsed);
+    if (result != 0)
+    {
+        std::cout << std::left << std::setw(24) << profile._name << std::right << std::setw(8) << fileData.size() << "  FAILED" << std::endl;
+        return -1;
+    }
+
+    if (loopback)
+    {
+        stats.commands = 0;
+        for (auto& command : transferStats.commands)
+        {
+            stats.commands += command.second.count;
+            stats.latencies[command.first] = command.second.latencies;
+        }
+    }
+
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    const double kiloBytes = static_cast<double>(fileData.size()) / 1024.0;
+
+    std::cout << std::left << std::setw(24) << profile._name << std::right
+              << std::setw(8) << fileData.size() << " byte(s)"
+              << std::fixed << std::setprecision(3)
+              << std::setw(10) << seconds << " s"
+              << std::setprecision(0)
+              << std::setw(10) << (static_cast<double>(fileData.size()) / seconds) << " byte(s)/s"
+              << std::setprecision(1)
+              << std::setw(8) << (static_cast<double>(stats.commands) / kiloBytes) << " round trip(s)/KB"
+              << std::defaultfloat << std::endl;
+
+    for (auto& latencies : stats.latencies)
+    {
+        PrintPercentiles("$" + latencies.first, latencies.second);
+    }
+    if (!loopback)
+    {
+        PrintPercentiles("host", stats.turnarounds);
+    }
+
+    return 0;
+}
+
+} // namespace
+
+void PrintHelp()
+{
+    std::cout << "codeGTransferBenchmark usage :" << std::endl << std::endl;
+
+    std::cout << "Measure the transfer throughput against an emulated MM1 writer board with every transfer profile" << std::endl;
+    std::cout << "\tthe latency of a command is measured from the command sent by the host to its reply received," << std::endl;
+    std::cout << "\tthe host latency is the time between a reply and the next command" << std::endl << std::endl;
+
+    std::cout << "Set the image sizes in bytes, default 1024,4096,16384" << std::endl;
+    std::cout << "\tcodeGTransferBenchmark --sizes=<number,number,...>" << std::endl << std::endl;
+
+    std::cout << "Set the emulated baudrate (0 to disable the wire latency), default " << DEFAULT_BENCHMARK_BAUDRATE << std::endl;
+    std::cout << "\tcodeGTransferBenchmark --baud=<number>" << std::endl << std::endl;
+
+    std::cout << "Set the memory model (must be eeprom or flash) default to flash" << std::endl;
+    std::cout << "\tcodeGTransferBenchmark --model=<name>" << std::endl << std::endl;
+
+    std::cout << "Set the processing time of every command in us, default 100" << std::endl;
+    std::cout << "\tcodeGTransferBenchmark --commandDelay=<number>" << std::endl << std::endl;
+
+    std::cout << "Set the image content, pseudo-random (incompressible) or code like, default to random" << std::endl;
+    std::cout << "\tcodeGTransferBenchmark --image=<random or code>" << std::endl << std::endl;
+
+    std::cout << "Set the transport to the emulator, a pseudo-terminal or the in-memory loopback, default to pty" << std::endl;
+    std::cout << "\tloopback : the commands are executed as soon as they are written, the latencies are the ones of the host" << std::endl;
+    std::cout << "\tcodeGTransferBenchmark --transport=<pty or loopback>" << std::endl << std::endl;
+
+    std::cout << "Print the help page (and do nothing else)" << std::endl;
+    std::cout << "\tcodeGTransferBenchmark --help" << std::endl << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<uint32_t> sizes = {1024, 4096, 16384};
+    uint8_t memoryModel = MEMM_FLASH;
+    bool codeImage = false;
+    bool loopback = false;
+
+    EmulatorSettings emulatorSettings;
+    emulatorSettings.baudrate = DEFAULT_BENCHMARK_BAUDRATE;
+
+    std::vector<std::string> commands(argv, argv + argc);
+
+    for (std::size_t i=1; i<commands.size(); ++i)
+    {
+        if (commands[i] == "--help")
+        {
+            PrintHelp();
+            return 0;
+        }
+
+        std::vector<std::string> splitedCommand;
+        Split(commands[i], splitedCommand, '=');
+
+        if (splitedCommand.size() == 2)
+        {
+            if ( splitedCommand[0] == "--sizes")
+            {
+                std::vector<std::string> splitedSizes;
+                Split(splitedCommand[1], splitedSizes, ',');
+
+                sizes.clear();
+                for (const std::string& sizeStr : splitedSizes)
+                {
+                    uint32_t size;
+                    if ( !GetNumberArgument(sizeStr, size) )
+                    {
+                        return -1;
+                    }
+                    if (size == 0 || size > emulatorSettings.eepromSize)
+                    {
+                        std::cout << "The image size must be between 1 and " << emulatorSettings.eepromSize << " !" << std::endl;
+                        return -1;
+                    }
+                    sizes.push_back(size);
+                }
+                continue;
+            }
+            if ( splitedCommand[0] == "--baud")
+            {
+                if ( !GetNumberArgument(splitedCommand[1], emulatorSettings.baudrate) )
+                {
+                    return -1;
+                }
+                continue;
+            }
+            if ( splitedCommand[0] == "--commandDelay")
+            {
+                if ( !GetNumberArgument(splitedCommand[1], emulatorSettings.commandDelay) )
+                {
+                    return -1;
+                }
+                continue;
+            }
+            if ( splitedCommand[0] == "--image")
+            {
+                if (splitedCommand[1] == "random" || splitedCommand[1] == "code")
+                {
+                    codeImage = (splitedCommand[1] == "code");
+                }
+                else
+                {
+                    std::cout << "Unknown image : \""<< splitedCommand[1] <<"\" !" << std::endl;
+                    return -1;
+                }
+                continue;
+            }
+            if ( splitedCommand[0] == "--transport")
+            {
+                if (splitedCommand[1] == "pty" || splitedCommand[1] == "loopback")
+                {
+                    loopback = (splitedCommand[1] == "loopback");
+                }
+                else
+                {
+                    std::cout << "Unknown transport : \""<< splitedCommand[1] <<"\" !" << std::endl;
+                    return -1;
+                }
+                continue;
+            }
+            if ( splitedCommand[0] == "--model")
+            {
+                if (splitedCommand[1] == "eeprom")
+                {
+                    memoryModel = MEMM_EEPROM;
+                }
+                else if (splitedCommand[1] == "flash")
+                {
+                    memoryModel = MEMM_FLASH;
+                }
+                else
+                {
+                    std::cout << "Unknown memory model : \""<< splitedCommand[1] <<"\" !" << std::endl;
+                    return -1;
+                }
+                continue;
+            }
+        }
+
+        //Unknown command
+        std::cout << "Unknown command : \""<< commands[i] <<"\" !" << std::endl;
+        return -1;
+    }
+
+    std::cout << "codeGTransferBenchmark version " << CGT_VERSION_MAJOR << "." << CGT_VERSION_MINOR << std::endl;
+    if (loopback)
+    {
+        std::cout << "In-memory loopback" << std::endl << std::endl;
+    }
+    else
+    {
+        std::cout << "Emulated baudrate : " << emulatorSettings.baudrate << std::endl << std::endl;
+    }
+
+    //Same pseudo-random image for every run
+    std::mt19937 generator(1);
+
+    int result = 0;
+    for (uint32_t size : sizes)
+    {
+        std::vector<uint8_t> fileData(size);
+        if (codeImage)
+        {
+            FillCodeImage(generator, fileData);
+        }
+        else
+        {
+            for (uint8_t& value : fileData)
+            {
+                value = static_cast<uint8_t>(generator());
+            }
+        }
+
+        for (const BenchmarkProfile& profile : gProfiles)
+        {
+            if (RunBenchmark(profile, fileData, memoryModel, emulatorSettings, loopback) != 0)
+            {
+                result = -1;
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    return result;
+}
@@ -0,0 +1,179 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <csignal>
+
+#include <unistd.h>
+
+#include "C_emulator.hpp"
+#include "CMakeConfig.hpp"
+
+namespace
+{
+
+std::atomic<bool> gRunning{true};
+
+void StopEmulator(int)
+{
+    gRunning = false;
+}
+
+bool GetNumberArgument(const std::string& str, uint32_t& value)
+{
+    try
+    {
+        value = std::stoul(str);
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "Can't convert \""<< str << "\" as a number !" << std::endl;
+        std::cout << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+void PrintHelp()
+{
+    std::cout << "codeGTransferEmulator usage :" << std::endl << std::endl;
+
+    std::cout << "Emulate a MM1 writer board on a pseudo-terminal, the host can then be started with --port=<printed path>" << std::endl << std::endl;
+
+    std::cout << "Set the emulated baudrate (0 to disable the wire latency), default 9600" << std::endl;
+    std::cout << "\tcodeGTransferEmulator --baud=<number>" << std::endl << std::endl;
+
+    std::cout << "Set the processing time of every command in us, default 100" << std::endl;
+    std::cout << "\tcodeGTransferEmulator --commandDelay=<number>" << std::endl << std::endl;
+
+    std::cout << "Set the EEPROM write time per started page in us, default 10000" << std::endl;
+    std::cout << "\tcodeGTransferEmulator --eepromWriteTime=<number>" << std::endl << std::endl;
+
+    std::cout << "Set the flash write time per byte in us, default 20" << std::endl;
+    std::cout << "\tcodeGTransferEmulator --flashWriteTime=<number>" << std::endl << std::endl;
+
+    std::cout << "Set the flash erase time per sector in us, default 25000" << std::endl;
+    std::cout << "\tcodeGTransferEmulator --flashEraseTime=<number>" << std::endl << std::endl;
+
+    std::cout << "Ignore one write or read command every n of them (a lost frame), default 0 (never)" << std::endl;
+    std::cout << "\tcodeGTransferEmulator --dropInterval=<number>" << std::endl << std::endl;
+
+    std::cout << "Set the information string returned by the board" << std::endl;
+    std::cout << "\tcodeGTransferEmulator --info=<string>" << std::endl << std::endl;
+
+    std::cout << "Print the help page (and do nothing else)" << std::endl;
+    std::cout << "\tcodeGTransferEmulator --help" << std::endl << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    EmulatorSettings settings;
+
+    std::vector<std::string> commands(argv, argv + argc);
+
+    for (std::size_t i=1; i<commands.size(); ++i)
+    {
+        if (commands[i] == "--help")
+        {
+            PrintHelp();
+            return 0;
+        }
+
+        std::size_t separator = commands[i].find('=');
+        if (separator != std::string::npos)
+        {
+            const std::string name = commands[i].substr(0, separator);
+            const std::string argument = commands[i].substr(separator+1);
+
+            if (name == "--info")
+            {
+                settings.information = argument;
+                continue;
+            }
+
+            uint32_t* value = nullptr;
+            if (name == "--baud")
+            {
+                value = &settings.baudrate;
+            }
+            else if (name == "--commandDelay")
+            {
+                value = &settings.commandDelay;
+            }
+            else if (name == "--eepromWriteTime")
+            {
+                value = &settings.eepromWriteTime;
+            }
+            else if (name == "--flashWriteTime")
+            {
+                value = &settings.flashWriteTime;
+            }
+            else if (name == "--flashEraseTime")
+            {
+                value = &settings.flashEraseTime;
+            }
+            else if (name == "--dropInterval")
+            {
+                value = &settings.dropInterval;
+            }
+
+            if (value != nullptr)
+            {
+                if ( !GetNumberArgument(argument, *value) )
+                {
+                    return -1;
+                }
+                continue;
+            }
+        }
+
+        //Unknown command
+        std::cout << "Unknown command : \""<< commands[i] <<"\" !" << std::endl;
+        return -1;
+    }
+
+    int masterFd;
+    int slaveFd;
+    std::string slavePath;
+    if ( !OpenPseudoTerminal(masterFd, slaveFd, slavePath) )
+    {
+        std::cout << "Can't open a pseudo-terminal !" << std::endl;
+        return -1;
+    }
+
+    std::signal(SIGINT, StopEmulator);
+    std::signal(SIGTERM, StopEmulator);
+
+    std::cout << "codeGTransferEmulator version " << CGT_VERSION_MAJOR << "." << CGT_VERSION_MINOR << std::endl;
+    std::cout << "Emulated board on : " << slavePath << std::endl;
+    std::cout << "Press Ctrl+C to stop" << std::endl;
+
+    Emulator emulator(settings);
+    EmulatorStats stats;
+    RunEmulator(emulator, masterFd, gRunning, stats);
+
+    close(slaveFd);
+    close(masterFd);
+
+    std::cout << std::endl << "Received " << stats.receivedBytes << " byte(s), sent " << stats.sentBytes
+              << " byte(s), " << stats.commands << " command(s)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,238 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+
+#include "C_string.hpp"
+#include "C_encoding.hpp"
+#include "C_frame.hpp"
+#include "C_checksum.hpp"
+#include "C_compression.hpp"
+#include "C_transfer.hpp"
+#include "CMakeConfig.hpp"
+
+#define DEFAULT_FRAME_ITERATIONS 200000
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+void PrintResult(const char* name, uint8_t encoding, uint8_t checksumType, uint32_t iterations, Clock::duration elapsed)
+{
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    const double megaBytes = static_cast<double>(iterations) * DEFAULT_NUMOFDATA / (1024.0*1024.0);
+
+    std::cout << std::left << std::setw(20) << name << std::setw(10) << GetEncodingName(encoding) << std::setw(8) << GetChecksumName(checksumType) << std::right
+              << std::fixed << std::setprecision(1)
+              << std::setw(10) << (megaBytes / seconds) << " MB/s"
+              << std::setw(10) << (seconds * 1e9 / iterations) << " ns/frame"
+              << std::defaultfloat << std::endl;
+}
+
+} // namespace
+
+void PrintHelp()
+{
+    std::cout << "codeGTransferFrameBenchmark usage :" << std::endl << std::endl;
+
+    std::cout << "Measure the host side throughput of the CRC-32, of the frame encoder and of the read reply check" << std::endl;
+    std::cout << "\tfor every data encoding and checksum, with chunks of " << DEFAULT_NUMOFDATA << " bytes," << std::endl;
+    std::cout << "\tand of the write frame compressions on a padded image (round trip checked)" << std::endl << std::endl;
+
+    std::cout << "Set the number of frames per measure, default " << DEFAULT_FRAME_ITERATIONS << std::endl;
+    std::cout << "\tcodeGTransferFrameBenchmark --iterations=<number>" << std::endl << std::endl;
+
+    std::cout << "Print the help page (and do nothing else)" << std::endl;
+    std::cout << "\tcodeGTransferFrameBenchmark --help" << std::endl << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = DEFAULT_FRAME_ITERATIONS;
+
+    std::vector<std::string> commands(argv, argv + argc);
+
+    for (std::size_t i=1; i<commands.size(); ++i)
+    {
+        if (commands[i] == "--help")
+        {
+            PrintHelp();
+            return 0;
+        }
+
+        std::vector<std::string> splitedCommand;
+        Split(commands[i], splitedCommand, '=');
+
+        if (splitedCommand.size() == 2 && splitedCommand[0] == "--iterations")
+        {
+            try
+            {
+                iterations = std::stoul(splitedCommand[1]);
+            }
+            catch (std::exception& e)
+            {
+                std::cout << "Can't convert \""<< splitedCommand[1] << "\" as a number !" << std::endl;
+                std::cout << e.what() << std::endl;
+                return -1;
+            }
+            if (iterations == 0)
+            {
+                std::cout << "The number of iterations can't be 0 !" << std::endl;
+                return -1;
+            }
+            continue;
+        }
+
+        //Unknown command
+        std::cout << "Unknown command : \""<< commands[i] <<"\" !" << std::endl;
+        return -1;
+    }
+
+    std::cout << "codeGTransferFrameBenchmark version " << CGT_VERSION_MAJOR << "." << CGT_VERSION_MINOR << std::endl << std::endl;
+
+    //64KB of pseudo-random data, the chunks are taken one after the other
+    std::mt19937 generator(1);
+    std::vector<uint8_t> data(0x10000);
+    for (uint8_t& value : data)
+    {
+        value = static_cast<uint8_t>(generator());
+    }
+    const uint32_t numOfChunks = data.size() / DEFAULT_NUMOFDATA;
+
+    ///CRC-32 kernel
+    {
+        uint32_t crc = CRC32_INIT;
+        Clock::time_point startTime = Clock::now();
+        for (uint32_t i=0; i<iterations; ++i)
+        {
+            const uint32_t address = (i%numOfChunks) * DEFAULT_NUMOFDATA;
+            crc = UpdateCrc32(crc, data.data()+address, DEFAULT_NUMOFDATA);
+        }
+        Clock::duration elapsed = Clock::now() - startTime;
+
+        const double seconds = std::chrono::duration<double>(elapsed).count();
+        std::cout << std::left << std::setw(38) << "crc32" << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << (static_cast<double>(iterations) * DEFAULT_NUMOFDATA / (1024.0*1024.0) / seconds) << " MB/s"
+                  << "  (" << std::hex << FinalizeCrc32(crc) << std::dec << ")" << std::defaultfloat << std::endl;
+    }
+
+    int result = 0;
+
+    ///Compressions, on the same data with a padding run every 256 bytes
+    {
+        std::vector<uint8_t> paddedData(data);
+        for (std::size_t i=0; i<paddedData.size(); i+=256)
+        {
+            std::fill(paddedData.begin()+i, paddedData.begin()+i+64, 0xFF);
+        }
+
+        std::vector<uint8_t> compressedData(GetCompressedMaxSize(DEFAULT_NUMOFDATA));
+        std::vector<uint8_t> expandedData(DEFAULT_NUMOFDATA);
+
+        for (uint8_t compression=COMP_NONE+1; compression<COMP_COUNT; ++compression)
+        {
+            std::size_t totalSize = 0;
+            uint32_t mismatches = 0;
+
+            Clock::time_point startTime = Clock::now();
+            for (uint32_t i=0; i<iterations; ++i)
+            {
+                const uint32_t address = (i%numOfChunks) * DEFAULT_NUMOFDATA;
+                const std::size_t size = CompressData(compression, paddedData.data()+address, DEFAULT_NUMOFDATA, compressedData.data());
+                totalSize += size;
+
+                if ( i < numOfChunks && (!DecompressData(compression, compressedData.data(), size, expandedData.data(), DEFAULT_NUMOFDATA) ||
+                                         !std::equal(expandedData.begin(), expandedData.end(), paddedData.begin()+address)) )
+                {
+                    ++mismatches;
+                }
+            }
+            Clock::duration elapsed = Clock::now() - startTime;
+
+            const double seconds = std::chrono::duration<double>(elapsed).count();
+            std::cout << std::left << std::setw(20) << "compress" << std::setw(18) << GetCompressionName(compression) << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(10) << (static_cast<double>(iterations) * DEFAULT_NUMOFDATA / (1024.0*1024.0) / seconds) << " MB/s"
+                      << std::setw(10) << (100.0 * totalSize / (static_cast<double>(iterations) * DEFAULT_NUMOFDATA)) << " % of the size"
+                      << std::defaultfloat << std::endl;
+
+            if (mismatches != 0)
+            {
+                std::cout << mismatches << " compressed chunk(s) didn't expand back !" << std::endl;
+                result = -1;
+            }
+        }
+    }
+
+    for (uint8_t checksumType=0; checksumType<CHECKSUM_COUNT; ++checksumType)
+    for (uint8_t encoding=0; encoding<ENC_COUNT; ++encoding)
+    {
+        std::string frame;
+        std::size_t totalSize = 0;
+
+        ///Encode
+        Clock::time_point startTime = Clock::now();
+        for (uint32_t i=0; i<iterations; ++i)
+        {
+            const uint32_t address = (i%numOfChunks) * DEFAULT_NUMOFDATA;
+            BuildSequencedWriteFrame(static_cast<uint8_t>(i), address, data.data()+address, DEFAULT_NUMOFDATA, encoding, checksumType, frame);
+            totalSize += frame.size();
+        }
+        PrintResult("write frame", encoding, checksumType, iterations, Clock::now() - startTime);
+
+        ///Build the read replies the board would send, then check them
+        std::vector<std::string> replies(numOfChunks);
+        for (uint32_t i=0; i<numOfChunks; ++i)
+        {
+            const uint8_t* chunkData = data.data() + i*DEFAULT_NUMOFDATA;
+            std::string& reply = replies[i];
+            uint8_t checksum[MAX_CHECKSUM_SIZE];
+            uint8_t checksumSize = GetChecksumBytes(chunkData, DEFAULT_NUMOFDATA, checksumType, checksum);
+
+            reply = "READED";
+            PushEncodedData(checksum, checksumSize, encoding, reply);
+            PushUint24InString(i*DEFAULT_NUMOFDATA, reply);
+            PushEncodedData(chunkData, DEFAULT_NUMOFDATA, encoding, reply);
+            reply += '\n';
+        }
+
+        uint32_t mismatches = 0;
+        startTime = Clock::now();
+        for (uint32_t i=0; i<iterations; ++i)
+        {
+            const uint32_t chunk = i%numOfChunks;
+            const uint32_t address = chunk * DEFAULT_NUMOFDATA;
+            if ( !CheckReadReply(replies[chunk], address, data.data()+address, DEFAULT_NUMOFDATA, encoding, checksumType) )
+            {
+                ++mismatches;
+            }
+        }
+        PrintResult("read reply check", encoding, checksumType, iterations, Clock::now() - startTime);
+
+        if (mismatches != 0 || totalSize == 0)
+        {
+            std::cout << mismatches << " read reply(s) didn't match !" << std::endl;
+            result = -1;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,293 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright 2021 Guillaume Guillet                                            //
+//                                                                             //
+// Licensed under the Apache License, Version 2.0 (the "License");             //
+// you may not use this file except in compliance with the License.            //
+// You may obtain a copy of the License at                                     //
+//                                                                             //
+//     http://www.apache.org/licenses/LICENSE-2.0                              //
+//                                                                             //
+// Unless required by applicable law or agreed to in writing, software         //
+// distributed under the License is distributed on an "AS IS" BASIS,           //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.    //
+// See the License for the specific language governing permissions and         //
+// limitations under the License.                                              //
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <memory>
+
+#include "C_string.hpp"
+#include "C_transfer.hpp"
+#include "C_options.hpp"
+#include "C_trace.hpp"
+#include "CMakeConfig.hpp"
+
+#define DEFAULT_REPLAY_TIMESCALE 1.0
+
+namespace
+{
+
+void PrintTraceHeader(const std::string& path, const Trace& trace)
+{
+    std::cout << "Trace \"" << path << "\" : codeGTransfer " << trace.version << ", port \"" << trace.portName << "\" at "
+              << trace.baudrate << " baud" << (trace.wireLimited ? "" : " (no wire)") << ", " << trace.events.size() << " event(s)" << std::endl;
+    std::cout << "\toptions :";
+    for (const std::string& option : trace.options)
+    {
+        std::cout << " " << option;
+    }
+    std::cout << std::endl;
+}
+
+/*
+ Run the transfer of the trace with this build against the recorded replies,
+ the options come from the trace and the journals and manifests from the manifest directory.
+*/
+int Replay(const Trace& trace, const TraceReport& report, double timeScale, const std::string& manifestDirectory,
+           const std::string& recordPath, bool printLog)
+{
+    TransferSettings settings;
+    bool dump = false;
+    uint32_t dumpLength = 0;
+
+    for (const std::string& option : trace.options)
+    {
+        if (option == "--dump")
+        {
+            dump = true;
+            continue;
+        }
+        if (option.compare(0, 9, "--length=") == 0)
+        {
+            dumpLength = std::stoul(option.substr(9));
+            continue;
+        }
+        if (ParseTransferOption(option, settings, std::cout) != OPTION_PARSED)
+        {
+            std::cout << "Unknown option in the trace : \"" << option << "\" !" << std::endl;
+            return -1;
+        }
+    }
+    if ( !CheckTransferSettings(settings, std::cout) )
+    {
+        return -1;
+    }
+    settings.manifestDirectory = manifestDirectory;
+
+    std::ostream nullLog(nullptr);
+    std::ostream& log = printLog ? std::cout : nullLog;
+
+    std::cout << std::endl << "Replaying the " << (dump ? "dump" : "transfer") << " at time scale " << timeScale << " ..." << std::endl;
+
+    std::unique_ptr<ReplayTransport> replayTransport(new ReplayTransport(trace, timeScale));
+    const ReplayTransport& replayPort = *replayTransport;
+    std::unique_ptr<Transport> port = std::move(replayTransport);
+
+    if ( !recordPath.empty() )
+    {
+        std::unique_ptr<RecordingTransport> recordingPort(new RecordingTransport(std::move(port), recordPath));
+        if ( !recordingPort->start(trace.options, trace.input) )
+        {
+            std::cout << "Can't write the trace \"" << recordPath << "\" !" << std::endl;
+            return -1;
+        }
+        port = std::move(recordingPort);
+    }
+
+    const StatsClock::time_point start = StatsClock::now();
+    int result = -1;
+    if (dump)
+    {
+        BoardSession session;
+        std::vector<uint8_t> data;
+        if ( OpenSession(*port, settings, session, log) )
+        {
+            result = DumpMemory(*port, settings.startAddress, dumpLength, data, settings, session, log);
+        }
+    }
+    else
+    {
+        result = TransferFile(*port, trace.input, settings, log);
+    }
+    const uint64_t total = std::chrono::duration_cast<std::chrono::microseconds>(StatsClock::now() - start).count();
+
+    std::cout << "Replay result : " << (result == 0 ? "OK" : "FAILED") << std::endl;
+    if (replayPort.isDiverged())
+    {
+        std::cout << "This build wrote other bytes than the recorded ones from byte " << replayPort.getDivergenceOffset()
+                  << ", the replies after it don't match" << std::endl;
+    }
+
+    const uint64_t wait = replayPort.getWaitTime();
+    const uint64_t host = (total > wait) ? total-wait : 0;
+    std::cout << "\ttotal        " << total/1000 << " ms" << std::endl;
+    std::cout << "\twaiting      " << wait/1000 << " ms (for the recorded replies)" << std::endl;
+    std::cout << "\thost         " << host/1000 << " ms, recorded " << report.host/1000 << " ms" << std::endl;
+
+    return (result == 0 && !replayPort.isDiverged()) ? 0 : -1;
+}
+
+} // namespace
+
+void PrintHelp()
+{
+    std::cout << "codeGTransferReplay usage :" << std::endl << std::endl;
+
+    std::cout << "Print where the time of a transfer recorded with codeGTransfer --record went" << std::endl;
+    std::cout << "\thost : between the port calls, waiting : in the port calls," << std::endl;
+    std::cout << "\twire : the bytes on the line, board : from a command received to its reply" << std::endl;
+    std::cout << "\tcodeGTransferReplay --trace=<path>" << std::endl << std::endl;
+
+    std::cout << "Compare the times with another trace of the same transfer (e.g. recorded with another build)" << std::endl;
+    std::cout << "\tcodeGTransferReplay --trace=<path> --compare=<path>" << std::endl << std::endl;
+
+    std::cout << "Run the transfer of the trace again with this build, the board replies come from the trace" << std::endl;
+    std::cout << "\tthe written bytes must be the recorded ones, the host time is compared with the recorded one" << std::endl;
+    std::cout << "\tcodeGTransferReplay --trace=<path> --replay" << std::endl << std::endl;
+
+    std::cout << "Set the time scale of the recorded replies, 1 for the original timing, 0 to receive them as soon as possible, default 1" << std::endl;
+    std::cout << "\tcodeGTransferReplay --timeScale=<number>" << std::endl << std::endl;
+
+    std::cout << "Record the replayed transfer to another trace, e.g. to compare it" << std::endl;
+    std::cout << "\tcodeGTransferReplay --record=<path>" << std::endl << std::endl;
+
+    std::cout << "Set the directory of the manifests and journals used by the replayed transfer, default to the working directory" << std::endl;
+    std::cout << "\tcodeGTransferReplay --manifestDir=<path>" << std::endl << std::endl;
+
+    std::cout << "Print the log of the replayed transfer" << std::endl;
+    std::cout << "\tcodeGTransferReplay --log" << std::endl << std::endl;
+
+    std::cout << "Print the help page (and do nothing else)" << std::endl;
+    std::cout << "\tcodeGTransferReplay --help" << std::endl << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    std::string tracePath;
+    std::string comparePath;
+    std::string recordPath;
+    std::string manifestDirectory = TransferSettings().manifestDirectory;
+    bool replay = false;
+    bool printLog = false;
+    double timeScale = DEFAULT_REPLAY_TIMESCALE;
+
+    std::vector<std::string> commands(argv, argv + argc);
+
+    for (std::size_t i=1; i<commands.size(); ++i)
+    {
+        if (commands[i] == "--help")
+        {
+            PrintHelp();
+            return 0;
+        }
+        if (commands[i] == "--replay")
+        {
+            replay = true;
+            continue;
+        }
+        if (commands[i] == "--log")
+        {
+            printLog = true;
+            continue;
+        }
+
+        std::vector<std::string> splitedCommand;
+        Split(commands[i], splitedCommand, '=');
+
+        if (splitedCommand.size() == 2)
+        {
+            if ( splitedCommand[0] == "--trace")
+            {
+                tracePath = splitedCommand[1];
+                continue;
+            }
+            if ( splitedCommand[0] == "--compare")
+            {
+                comparePath = splitedCommand[1];
+                continue;
+            }
+            if ( splitedCommand[0] == "--record")
+            {
+                recordPath = splitedCommand[1];
+                continue;
+            }
+            if ( splitedCommand[0] == "--manifestDir")
+            {
+                manifestDirectory = splitedCommand[1];
+                continue;
+            }
+            if ( splitedCommand[0] == "--timeScale")
+            {
+                try
+                {
+                    timeScale = std::stod(splitedCommand[1]);
+                }
+                catch (std::exception& e)
+                {
+                    std::cout << "Can't convert \""<< splitedCommand[1] << "\" as a number !" << std::endl;
+                    std::cout << e.what() << std::endl;
+                    return -1;
+                }
+                if (timeScale < 0.0)
+                {
+                    std::cout << "The time scale can't be negative !" << std::endl;
+                    return -1;
+                }
+                continue;
+            }
+        }
+
+        //Unknown command
+        std::cout << "Unknown command : \""<< commands[i] <<"\" !" << std::endl;
+        return -1;
+    }
+
+    if ( tracePath.empty() )
+    {
+        PrintHelp();
+        return -1;
+    }
+
+    std::cout << "codeGTransferReplay version " << CGT_VERSION_MAJOR << "." << CGT_VERSION_MINOR << std::endl << std::endl;
+
+    Trace trace;
+    if ( !LoadTrace(tracePath, trace, std::cout) )
+    {
+        return -1;
+    }
+    TraceReport report;
+    AnalyseTrace(trace, report);
+
+    PrintTraceHeader(tracePath, trace);
+    PrintTraceReport(report, std::cout);
+
+    if ( !comparePath.empty() )
+    {
+        Trace otherTrace;
+        if ( !LoadTrace(comparePath, otherTrace, std::cout) )
+        {
+            return -1;
+        }
+        TraceReport otherReport;
+        AnalyseTrace(otherTrace, otherReport);
+
+        std::cout << std::endl;
+        PrintTraceHeader(comparePath, otherTrace);
+        if (otherTrace.options != trace.options || otherTrace.input != trace.input)
+        {
+            std::cout << "The traces are not of the same transfer (options or input) !" << std::endl;
+        }
+        std::cout << std::endl << "Comparison (\"" << tracePath << "\" -> \"" << comparePath << "\") :" << std::endl;
+        PrintTraceComparison(report, otherReport, std::cout);
+    }
+
+    if (replay)
+    {
+        return Replay(trace, report, timeScale, manifestDirectory, recordPath, printLog);
+    }
+    return 0;
+}